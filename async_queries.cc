@@ -0,0 +1,243 @@
+// Async_queries.cc
+//
+// Student name:
+// Student email:
+// Student number:
+
+#include "async_queries.hh"
+
+#include <algorithm>
+
+/**
+ * @brief ThreadPool::ThreadPool starts the worker threads
+ * @param threads the number of worker threads
+ */
+ThreadPool::ThreadPool(unsigned int threads)
+{
+    threads = std::max(threads, 1u);
+    for (unsigned int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+/**
+ * @brief ThreadPool::~ThreadPool runs the queued jobs and stops the worker threads
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobs_available.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+/**
+ * @brief ThreadPool::submit queues a job for the worker threads
+ * @param job the job
+ */
+void ThreadPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobs_available.notify_one();
+}
+
+/**
+ * @brief ThreadPool::work runs queued jobs until the pool is stopped and no jobs are left
+ */
+void ThreadPool::work()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobs_available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+            {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+/**
+ * @brief AsyncDatastructures::AsyncDatastructures constructor of the class
+ * @param ds the datastructure queried
+ * @param threads the number of threads running queries
+ * @param cache_capacity the number of results kept for each query operation
+ */
+AsyncDatastructures::AsyncDatastructures(Datastructures& ds, unsigned int threads, std::size_t cache_capacity) :
+    datastructures(ds), departures_cache(cache_capacity), closest_cache(cache_capacity), pool(threads)
+{}
+
+/**
+ * @brief AsyncDatastructures::station_departures_after lists the departures from given station after given time
+ * @param stationid the id of the station whose departures are listed
+ * @param time the earliest time of the day for which departures are listed
+ * @return awaitable giving the departures as time, train pairs
+ */
+auto AsyncDatastructures::station_departures_after(StationID stationid, Time time)
+    -> QueryAwaiter<std::pair<StationID, Time>, Departures>
+{
+    return {*this, departures_cache, {stationid, time}, [this, stationid, time]()
+    {
+        return datastructures.station_departures_after(stationid, time);
+    }};
+}
+
+/**
+ * @brief AsyncDatastructures::stations_closest_to finds 3 stations located closest to the given coordinate
+ * @param xy the coordinate for which the closest stations are searched
+ * @return awaitable giving the ids of the 3 closest stations
+ */
+auto AsyncDatastructures::stations_closest_to(Coord xy) -> QueryAwaiter<Coord, std::vector<StationID>>
+{
+    return {*this, closest_cache, xy, [this, xy]()
+    {
+        return datastructures.stations_closest_to(xy);
+    }};
+}
+
+/**
+ * @brief AsyncDatastructures::add_departure saves a train departure for given station
+ * @param stationid the id of the station that the train departs from
+ * @param trainid the id of the train departing
+ * @param time the time of the departure
+ * @return bool value indicating if saving the departure was successful
+ */
+bool AsyncDatastructures::add_departure(StationID stationid, TrainID trainid, Time time)
+{
+    std::unique_lock<std::shared_mutex> lock(datastructures_mutex);
+    bool add_success = datastructures.add_departure(stationid, trainid, time);
+    if (add_success)
+    {
+        invalidate_departures(stationid);
+    }
+    return add_success;
+}
+
+/**
+ * @brief AsyncDatastructures::remove_departure removes a train departure from a given station
+ * @param stationid the id of the station that the departure is removed from
+ * @param trainid the id of the train departing
+ * @param time the time of the departure
+ * @return bool value indicating if removing the departure was successful
+ */
+bool AsyncDatastructures::remove_departure(StationID stationid, TrainID trainid, Time time)
+{
+    std::unique_lock<std::shared_mutex> lock(datastructures_mutex);
+    bool remove_success = datastructures.remove_departure(stationid, trainid, time);
+    if (remove_success)
+    {
+        invalidate_departures(stationid);
+    }
+    return remove_success;
+}
+
+/**
+ * @brief AsyncDatastructures::change_station_coord changes the coordinates of a station with given id
+ * @param id the id of the station whose coordinates are to be changed
+ * @param newcoord the new coordinates of the station
+ * @return bool value indicating if changing coordinates was successful
+ */
+bool AsyncDatastructures::change_station_coord(StationID id, Coord newcoord)
+{
+    std::unique_lock<std::shared_mutex> lock(datastructures_mutex);
+    bool change_success = datastructures.change_station_coord(id, newcoord);
+    if (change_success)
+    {
+        invalidate_closest();
+    }
+    return change_success;
+}
+
+/**
+ * @brief AsyncDatastructures::add_station saves a new station to the datastructure
+ * @param id the unique indentifier of the new station
+ * @param name the name of the new station
+ * @param xy the coordinates of the new station
+ * @return bool value indicating if saving the station was succesfull
+ */
+bool AsyncDatastructures::add_station(StationID id, const Name& name, Coord xy)
+{
+    std::unique_lock<std::shared_mutex> lock(datastructures_mutex);
+    // A not found result of the id may be cached for its departures
+    bool add_success = datastructures.add_station(id, name, xy);
+    if (add_success)
+    {
+        invalidate_departures(id);
+        invalidate_closest();
+    }
+    return add_success;
+}
+
+/**
+ * @brief AsyncDatastructures::remove_station removes a station from the datastructure
+ * @param id the id of the station that is to be removed
+ * @return bool value indicating if the removal was successful
+ */
+bool AsyncDatastructures::remove_station(StationID id)
+{
+    std::unique_lock<std::shared_mutex> lock(datastructures_mutex);
+    bool remove_success = datastructures.remove_station(id);
+    if (remove_success)
+    {
+        invalidate_departures(id);
+        invalidate_closest();
+    }
+    return remove_success;
+}
+
+/**
+ * @brief AsyncDatastructures::clear_all clears the datastructure
+ */
+void AsyncDatastructures::clear_all()
+{
+    std::unique_lock<std::shared_mutex> lock(datastructures_mutex);
+    datastructures.clear_all();
+    invalidate_all();
+}
+
+/**
+ * @brief AsyncDatastructures::invalidate_departures drops the cached and running departure queries of a station
+ * @param stationid the id of the station
+ */
+void AsyncDatastructures::invalidate_departures(const StationID& stationid)
+{
+    std::lock_guard<std::mutex> cache_lock(departures_cache.mutex);
+    departures_cache.invalidate({stationid, std::numeric_limits<Time>::min()},
+                                {stationid, std::numeric_limits<Time>::max()});
+}
+
+/**
+ * @brief AsyncDatastructures::invalidate_closest drops the cached and running closest stations queries
+ */
+void AsyncDatastructures::invalidate_closest()
+{
+    std::lock_guard<std::mutex> cache_lock(closest_cache.mutex);
+    closest_cache.invalidate_all();
+}
+
+/**
+ * @brief AsyncDatastructures::invalidate_all drops all cached and running queries
+ */
+void AsyncDatastructures::invalidate_all()
+{
+    {
+        std::lock_guard<std::mutex> cache_lock(departures_cache.mutex);
+        departures_cache.invalidate_all();
+    }
+    invalidate_closest();
+}
@@ -0,0 +1,330 @@
+// Async_queries.hh
+//
+// Student name:
+// Student email:
+// Student number:
+
+#ifndef ASYNC_QUERIES_HH
+#define ASYNC_QUERIES_HH
+
+#include "datastructures.hh"
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+// Fixed size pool of threads running submitted jobs in the order they were
+// submitted. Jobs still queued when the pool is destroyed are run first.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threads);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    void submit(std::function<void()> job);
+
+private:
+    // Main loop of a worker thread
+    void work();
+
+    std::mutex mutex;
+    std::condition_variable jobs_available;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+// Coroutine front-end for a Datastructures shared by many concurrent
+// requests (needs C++20). Queries are awaited and run on a thread pool:
+//
+//   auto departures = co_await queries.station_departures_after(id, now);
+//
+// Identical queries awaited while one is already running wait for its
+// result instead of running again, and recent results are kept in a small
+// cache. The mutating operations run on the calling thread and drop the
+// cached and running queries whose results they may change. While the
+// front-end is in use, the datastructure must only be edited through it,
+// other edits can be run with with_exclusive:
+//
+//   queries.with_exclusive([](Datastructures& ds) { ds.add_region(id, name, coords); });
+class AsyncDatastructures
+{
+public:
+    using Departures = std::vector<std::pair<Time, TrainID>>;
+
+private:
+    // Results and running queries of one query operation, keyed by its arguments
+    template <typename Key, typename Result>
+    struct QueryCache
+    {
+        // A running query and the coroutines waiting for its result, error is
+        // set instead of the result when the query throws
+        struct InFlight {
+            Result result = {};
+            std::exception_ptr error = nullptr;
+            std::vector<std::coroutine_handle<>> waiters = {};
+        };
+
+        // A cached result and its position in the use order
+        struct Cached {
+            Result result;
+            typename std::list<Key>::iterator use;
+        };
+
+        explicit QueryCache(std::size_t capacity) : capacity(capacity) {}
+
+        // Returns a cached result, nullptr if there is none, and marks it as
+        // the most recently used
+        Result const* find(Key const& key)
+        {
+            auto cached = results.find(key);
+            if (cached == results.end())
+            {
+                return nullptr;
+            }
+            uses.splice(uses.begin(), uses, cached->second.use);
+            return &cached->second.result;
+        }
+
+        // Saves a result, dropping the least recently used result when full
+        void store(Key const& key, Result const& result)
+        {
+            auto cached = results.find(key);
+            if (cached != results.end())
+            {
+                cached->second.result = result;
+                uses.splice(uses.begin(), uses, cached->second.use);
+                return;
+            }
+            if (capacity == 0)
+            {
+                return;
+            }
+            if (results.size() >= capacity)
+            {
+                results.erase(uses.back());
+                uses.pop_back();
+            }
+            uses.push_front(key);
+            results.emplace(key, Cached{result, uses.begin()});
+        }
+
+        // Forgets results and running queries with keys from first to last
+        void invalidate(Key const& first, Key const& last)
+        {
+            auto begin = results.lower_bound(first);
+            auto end = results.upper_bound(last);
+            for (auto cached = begin; cached != end; ++cached)
+            {
+                uses.erase(cached->second.use);
+            }
+            results.erase(begin, end);
+            in_flight.erase(in_flight.lower_bound(first), in_flight.upper_bound(last));
+            ++generation;
+        }
+
+        // Forgets all results and running queries
+        void invalidate_all()
+        {
+            results.clear();
+            uses.clear();
+            in_flight.clear();
+            ++generation;
+        }
+
+        std::mutex mutex;
+        std::size_t capacity;
+        std::map<Key, Cached> results = {};
+        // Keys of the results, most recently used first
+        std::list<Key> uses = {};
+        std::map<Key, std::shared_ptr<InFlight>> in_flight = {};
+        // Changes on every invalidation, results of queries started before
+        // an invalidation are not cached
+        unsigned long generation = 0;
+    };
+
+public:
+    // Awaitable result of a query
+    template <typename Key, typename Result>
+    class [[nodiscard]] QueryAwaiter
+    {
+    public:
+        QueryAwaiter(AsyncDatastructures& owner, QueryCache<Key, Result>& cache,
+                     Key key, std::function<Result()> query) :
+            owner(owner), cache(cache), key(std::move(key)), query(std::move(query))
+        {}
+
+        bool await_ready() const noexcept { return false; }
+
+        // Returns false (does not suspend) when the result is in the cache
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            if (auto cached = cache.find(key))
+            {
+                result = *cached;
+                return false;
+            }
+            auto running = cache.in_flight.find(key);
+            if (running != cache.in_flight.end())
+            {
+                flight = running->second;
+            }
+            else
+            {
+                // The query is published only after it has been submitted, so
+                // a failed submit leaves no entry for later awaiters to wait
+                // on. The job can not finish before this function returns, as
+                // it needs the cache mutex.
+                auto new_flight = std::make_shared<typename QueryCache<Key, Result>::InFlight>();
+                owner.pool.submit([&owner = owner, &cache = cache, key = key, query = query,
+                                   flight = new_flight, generation = cache.generation]()
+                {
+                    Result computed;
+                    // An exception is passed to the waiters, escaping the job
+                    // would stop the pool and leave them suspended
+                    std::exception_ptr error = nullptr;
+                    try
+                    {
+                        std::shared_lock<std::shared_mutex> read_lock(owner.datastructures_mutex);
+                        computed = query();
+                    }
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                    }
+                    std::vector<std::coroutine_handle<>> waiters;
+                    {
+                        std::lock_guard<std::mutex> lock(cache.mutex);
+                        flight->result = std::move(computed);
+                        flight->error = error;
+                        auto entry = cache.in_flight.find(key);
+                        if (entry != cache.in_flight.end() && entry->second == flight)
+                        {
+                            cache.in_flight.erase(entry);
+                        }
+                        if (error == nullptr && cache.generation == generation)
+                        {
+                            cache.store(key, flight->result);
+                        }
+                        waiters.swap(flight->waiters);
+                    }
+                    for (auto waiter : waiters)
+                    {
+                        waiter.resume();
+                    }
+                });
+                cache.in_flight.emplace(key, new_flight);
+                flight = std::move(new_flight);
+            }
+            flight->waiters.push_back(handle);
+            return true;
+        }
+
+        // Rethrows the exception of a query that failed
+        Result await_resume()
+        {
+            if (flight == nullptr)
+            {
+                return std::move(result);
+            }
+            if (flight->error != nullptr)
+            {
+                std::rethrow_exception(flight->error);
+            }
+            return flight->result;
+        }
+
+    private:
+        AsyncDatastructures& owner;
+        QueryCache<Key, Result>& cache;
+        Key key;
+        std::function<Result()> query;
+        Result result = {};
+        std::shared_ptr<typename QueryCache<Key, Result>::InFlight> flight = nullptr;
+    };
+
+    AsyncDatastructures(Datastructures& ds,
+                        unsigned int threads = std::thread::hardware_concurrency(),
+                        std::size_t cache_capacity = 1024);
+
+    // Estimate of performance: O(logc), O(d) on a cache miss
+    // Short rationale for estimate: searching the cache and running queries, the query
+    // itself is run on the pool only if neither has it
+    QueryAwaiter<std::pair<StationID, Time>, Departures> station_departures_after(StationID stationid, Time time);
+
+    // Estimate of performance: O(logc), O(nlogn) on a cache miss
+    // Short rationale for estimate: searching the cache and running queries, the query
+    // itself is run on the pool only if neither has it
+    QueryAwaiter<Coord, std::vector<StationID>> stations_closest_to(Coord xy);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: add_departure and dropping the cached results of the station
+    bool add_departure(StationID stationid, TrainID trainid, Time time);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: remove_departure and dropping the cached results of the station
+    bool remove_departure(StationID stationid, TrainID trainid, Time time);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: change_station_coord and dropping all cached closest stations
+    bool change_station_coord(StationID id, Coord newcoord);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: add_station and dropping all cached closest stations
+    // and the cached departures of the station
+    bool add_station(StationID id, Name const& name, Coord xy);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: remove_station and dropping all cached closest stations
+    // and the cached departures of the station
+    bool remove_station(StationID id);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: clear_all and dropping all cached results
+    void clear_all();
+
+    // Runs function(datastructure) with the datastructure locked for editing,
+    // then drops all cached and running queries. Returns what function returns.
+    template <typename Function>
+    auto with_exclusive(Function function) -> decltype(function(std::declval<Datastructures&>()))
+    {
+        std::unique_lock<std::shared_mutex> lock(datastructures_mutex);
+        // Also run when function throws, it may have edited the datastructure
+        struct InvalidateOnExit {
+            AsyncDatastructures& owner;
+            ~InvalidateOnExit() { owner.invalidate_all(); }
+        } invalidate{*this};
+        return function(datastructures);
+    }
+
+private:
+    // Drops the cached departures of a station
+    void invalidate_departures(StationID const& stationid);
+
+    // Drops all cached closest stations
+    void invalidate_closest();
+
+    // Drops all cached results
+    void invalidate_all();
+
+    // The datastructure, reads share it and edits have it exclusively
+    Datastructures& datastructures;
+    std::shared_mutex datastructures_mutex;
+
+    QueryCache<std::pair<StationID, Time>, Departures> departures_cache;
+    QueryCache<Coord, std::vector<StationID>> closest_cache;
+
+    // Declared last so that it is destroyed, and its jobs finished, first
+    ThreadPool pool;
+};
+
+#endif // ASYNC_QUERIES_HH
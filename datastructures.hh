@@ -20,6 +20,23 @@
 #include <unordered_set>
 #include <cmath>
 #include <memory>
+#include <random>
+
+#include "interned.hh"
+#include "persistent_map.hh"
+
+extern std::minstd_rand rand_engine; // Reasonably quick pseudo-random generator
+
+template <typename Type>
+Type random_in_range(Type start, Type end)
+{
+    auto range = end-start;
+    ++range;
+
+    auto num = std::uniform_int_distribution<unsigned long int>(0, range-1)(rand_engine);
+
+    return static_cast<Type>(start+num);
+}
 
 // Types for IDs
 using StationID = std::string;
@@ -29,32 +46,39 @@ using Name = std::string;
 using Time = unsigned short int;
 
 // Return values for cases where required thing was not found
-StationID const NO_STATION = "---";
-TrainID const NO_TRAIN = "---";
+inline StationID const NO_STATION = "---";
+inline TrainID const NO_TRAIN = "---";
 RegionID const NO_REGION = -1;
-Name const NO_NAME = "!NO_NAME!";
+inline Name const NO_NAME = "!NO_NAME!";
 Time const NO_TIME = 9999;
 
 // Return value for cases where integer values were not found
 int const NO_VALUE = std::numeric_limits<int>::min();
 
-// Type for a coordinate (x, y)
-struct Coord
+// Type for a coordinate (x, y) with coordinate values of type Value
+template <typename Value>
+struct BasicCoord
 {
-    int x = NO_VALUE;
-    int y = NO_VALUE;
+    Value x = std::numeric_limits<Value>::min();
+    Value y = std::numeric_limits<Value>::min();
 };
 
+// Type for a coordinate (x, y)
+using Coord = BasicCoord<int>;
+
 // Example: Defining == and hash function for Coord so that it can be used
 // as key for std::unordered_map/set, if needed
-inline bool operator==(Coord c1, Coord c2) { return c1.x == c2.x && c1.y == c2.y; }
-inline bool operator!=(Coord c1, Coord c2) { return !(c1==c2); } // Not strictly necessary
+template <typename Value>
+inline bool operator==(BasicCoord<Value> c1, BasicCoord<Value> c2) { return c1.x == c2.x && c1.y == c2.y; }
+template <typename Value>
+inline bool operator!=(BasicCoord<Value> c1, BasicCoord<Value> c2) { return !(c1==c2); } // Not strictly necessary
 
 struct CoordHash
 {
-    std::size_t operator()(Coord xy) const
+    template <typename Value>
+    std::size_t operator()(BasicCoord<Value> xy) const
     {
-        auto hasher = std::hash<int>();
+        auto hasher = std::hash<Value>();
         auto xhash = hasher(xy.x);
         auto yhash = hasher(xy.y);
         // Combine hash values (magic!)
@@ -64,7 +88,8 @@ struct CoordHash
 
 // Example: Defining < for Coord so that it can be used
 // as key for std::map/set
-inline bool operator<(Coord c1, Coord c2)
+template <typename Value>
+inline bool operator<(BasicCoord<Value> c1, BasicCoord<Value> c2)
 {
     int d1 = std::hypot(c1.x, c1.y);
     int d2 = std::hypot(c2.x, c2.y);
@@ -101,13 +126,121 @@ private:
 };
 
 
+// Traits selecting the types used by BasicDatastructures. The default
+// traits use the types and return values defined above. The return value
+// functions are constexpr; string values are returned by reference to the
+// constants above, which are initialized before anything that uses them.
+struct DefaultTraits
+{
+    using StationID = ::StationID;
+    using TrainID = ::TrainID;
+    using RegionID = ::RegionID;
+    using Name = ::Name;
+    using Time = ::Time;
+    using CoordValue = int;
+
+    static constexpr StationID const& no_station() { return NO_STATION; }
+    static constexpr TrainID const& no_train() { return NO_TRAIN; }
+    static constexpr RegionID no_region() { return NO_REGION; }
+    static constexpr Name const& no_name() { return NO_NAME; }
+    static constexpr Time no_time() { return NO_TIME; }
+};
+
+// Traits for datasets whose station and train ids are numbers, ids are
+// hashed and compared as integers instead of strings
+struct NumericIdTraits : DefaultTraits
+{
+    using StationID = unsigned long long int;
+    using TrainID = unsigned long long int;
+
+    static constexpr StationID no_station() { return std::numeric_limits<StationID>::max(); }
+    static constexpr TrainID no_train() { return std::numeric_limits<TrainID>::max(); }
+};
+
+// Traits for small datasets on a 16-bit grid with 32-bit region ids.
+// Coordinates take half the space of the default ones. The coordinate and
+// region of a station share one 8-byte word, so station records are 8
+// bytes smaller. A region vertex takes 20 bytes instead of 24, as the
+// limits repacked for point-in-region tests are doubles for all traits.
+struct Grid16Traits : DefaultTraits
+{
+    using RegionID = unsigned int;
+    using CoordValue = short int;
+
+    static constexpr RegionID no_region() { return std::numeric_limits<RegionID>::max(); }
+};
+
 // This is the class you are supposed to implement
 
-class Datastructures
+template <typename Traits = DefaultTraits>
+class BasicDatastructures
 {
 public:
-    Datastructures();
-    ~Datastructures();
+    // Types and return values selected by the traits
+    using StationID = typename Traits::StationID;
+    using TrainID = typename Traits::TrainID;
+    using RegionID = typename Traits::RegionID;
+    using Name = typename Traits::Name;
+    using Time = typename Traits::Time;
+    using Coord = BasicCoord<typename Traits::CoordValue>;
+
+    // Constant initialized, so they can be used during the dynamic
+    // initialization of other static objects
+    static constexpr StationID const& NO_STATION = Traits::no_station();
+    static constexpr TrainID const& NO_TRAIN = Traits::no_train();
+    static constexpr RegionID NO_REGION = Traits::no_region();
+    static constexpr Name const& NO_NAME = Traits::no_name();
+    static constexpr Time NO_TIME = Traits::no_time();
+    static constexpr Coord NO_COORD = {};
+
+    BasicDatastructures();
+    ~BasicDatastructures();
+
+    // Copying forks the datastructure: the copy shares the containers and
+    // records with the original. An edit copies only the container nodes on
+    // the path to the edited entry and the edited record, so the memory of a
+    // fork grows with the number of edits made to it.
+    // Estimate of performance: O(1)
+    // Short rationale for estimate: only the roots of the containers are copied
+    BasicDatastructures(BasicDatastructures const& other) = default;
+    BasicDatastructures& operator=(BasicDatastructures const& other) = default;
+
+    // Differences between two versions of the datastructure, as seen from
+    // the version diff_versions is called on
+    struct VersionDiff {
+        std::vector<StationID> added_stations = {};
+        std::vector<StationID> removed_stations = {};
+        std::vector<StationID> changed_stations = {};
+        std::vector<RegionID> added_regions = {};
+        std::vector<RegionID> removed_regions = {};
+        std::vector<RegionID> changed_regions = {};
+    };
+
+    // Estimated bytes used by each container of the datastructure, including
+    // the records and strings they own. Nodes and records shared with forked
+    // versions are counted fully for each version. Station ids and names are
+    // interned, each is counted once in the container listed below.
+    struct MemoryUsage {
+        std::size_t station_index = 0;    // station map nodes and station ids
+        std::size_t station_records = 0;  // station records
+        std::size_t departures = 0;       // departure vectors of all stations
+        std::size_t coord_index = 0;      // coordinate map nodes
+        std::size_t name_index = 0;       // name set nodes and station names
+        std::size_t region_index = 0;     // region map and region order nodes
+        std::size_t region_records = 0;   // region records, their names and subregion vectors
+        std::size_t region_limits = 0;    // region shapes: limits and their packed copies
+
+        std::size_t total() const
+        {
+            return station_index + station_records + departures + coord_index + name_index
+                    + region_index + region_records + region_limits;
+        }
+
+        // Bytes saved by interning, not included in the total: the difference to
+        // every container and record keeping its own copy of the ids and names.
+        // Negative when short unique strings cost more to share than to copy.
+        std::ptrdiff_t interned_savings = 0;
+    };
 
     // Estimate of performance: O(1)
     // Short rationale for estimate: getting container size is constant timed
@@ -121,16 +254,17 @@ public:
     // Short rationale for estimate: just returning an existing vector
     std::vector<StationID> all_stations();
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: inserting to map is the most expensive operation
+    // Estimate of performance: O(logn)
+    // Short rationale for estimate: inserting to three maps, the name is shared with
+    // a station of the same name found in the name set
     bool add_station(StationID id, Name const& name, Coord xy);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searching from unordered map by key
+    // Estimate of performance: O(logn)
+    // Short rationale for estimate: searching from map by key
     Name get_station_name(StationID id);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searching from unordered map by key
+    // Estimate of performance: O(logn)
+    // Short rationale for estimate: searching from map by key
     Coord get_station_coordinates(StationID id);
 
     // Estimate of performance: O(n)
@@ -141,48 +275,49 @@ public:
     // Short rationale for estimate: looping through a map n times
     std::vector<StationID> stations_distance_increasing();
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: looping through unordered map to find a value
+    // Estimate of performance: O(logn)
+    // Short rationale for estimate: searching from map by key
     StationID find_station_with_coord(Coord xy);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searching from unordered map by key
+    // Estimate of performance: O(logn)
+    // Short rationale for estimate: searching from map by key and moving one map entry
     bool change_station_coord(StationID id, Coord newcoord);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searching from unordered map and inserting one item to set
+    // Estimate of performance: O(logn + d)
+    // Short rationale for estimate: searching from map and inserting one item to sorted vector
     bool add_departure(StationID stationid, TrainID trainid, Time time);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searching from unordered map and erasing from set
+    // Estimate of performance: O(logn + d)
+    // Short rationale for estimate: searching from map and erasing from sorted vector
     bool remove_departure(StationID stationid, TrainID trainid, Time time);
 
     // Estimate of performance: O(n)
     // Short rationale for estimate: constant time operations for each of station's departures
     std::vector<std::pair<Time, TrainID>> station_departures_after(StationID stationid, Time time);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: inserting one item to unordered map
+    // Estimate of performance: O(logn + c)
+    // Short rationale for estimate: inserting one item to map and repacking its limits
     bool add_region(RegionID id, Name const& name, std::vector<Coord> coords);
 
     // Estimate of performance: O(n)
     // Short rationale for estimate: constant time operation for n items
     std::vector<RegionID> all_regions();
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searching from unordered map by key
+    // Estimate of performance: O(logn)
+    // Short rationale for estimate: searching from map by key
     Name get_region_name(RegionID id);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searching from unordered map by key
+    // Estimate of performance: O(logn + c)
+    // Short rationale for estimate: searching from map by key, copying the limits
     std::vector<Coord> get_region_coords(RegionID id);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searching from unordered map by key, pushing back to vector
+    // Estimate of performance: O((h + s)logn)
+    // Short rationale for estimate: searching from map by key, pushing back to vector, walking
+    // the h parents of the parent region and reordering the s regions of the moved subtree
     bool add_subregion_to_region(RegionID id, RegionID parentid);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searching from unordered map by key
+    // Estimate of performance: O(logn)
+    // Short rationale for estimate: searching from map by key
     bool add_station_to_region(StationID id, RegionID parentid);
 
     // Estimate of performance: O(n)
@@ -199,14 +334,64 @@ public:
     // Short rationale for estimate: inserting to map n times
     std::vector<StationID> stations_closest_to(Coord xy);
 
-    // Estimate of performance: O(n)
-    // Short rationale for estimate: searcing from vector by value
+    // Estimate of performance: O(logn)
+    // Short rationale for estimate: erasing from three maps
     bool remove_station(StationID id);
 
     // Estimate of performance: O(n)
     // Short rationale for estimate: linear operations for two regions
     RegionID common_parent_of_regions(RegionID id1, RegionID id2);
 
+    // Estimate of performance: O(p*r*c)
+    // Short rationale for estimate: each of p coordinates is tested against the limits of
+    // r regions with c vertices, 4 or 8 edges at a time with AVX2/AVX-512. The regions are
+    // kept in testing order as the region tree changes.
+    // Returns the innermost region containing each coordinate, NO_REGION if none does
+    std::vector<RegionID> regions_containing(std::vector<Coord> const& coords);
+
+    // Batched insertion operations used by the data loaders. The ids and
+    // names of a batch are either strings, which are moved into the
+    // datastructure, or views such as std::string_view, which are copied only
+    // when they are saved.
+
+    // Estimate of performance: O(nlogn)
+    // Short rationale for estimate: each station is inserted like in add_station
+    template <typename IdText, typename NameText>
+    unsigned int add_stations(std::vector<std::tuple<IdText, NameText, Coord>> stations);
+
+    // Estimate of performance: O(nlogn)
+    // Short rationale for estimate: the batch is sorted by station unless it already is, each
+    // station is searched once and its new departures are sorted and merged with the old ones
+    template <typename IdText, typename TrainText>
+    unsigned int add_departures(std::vector<std::tuple<IdText, TrainText, Time>> departures);
+
+    // Memory management operations
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: every record and departure is visited once
+    MemoryUsage memory_usage();
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: shrinking the vectors of every record
+    void compact();
+
+    // What-if planning operations
+
+    // Estimate of performance: O(1)
+    // Short rationale for estimate: containers are shared with the fork, not copied
+    BasicDatastructures fork();
+
+    // Estimate of performance: O(n + slogn)
+    // Short rationale for estimate: walking the parents of the new parent region, erasing
+    // from the old parent's subregion vector and reordering the s regions of the moved subtree
+    bool move_subregion_to_region(RegionID id, RegionID parentid);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: the sorted containers of the versions are walked side
+    // by side, records shared by both versions are skipped with a pointer comparison and
+    // others are compared by value
+    VersionDiff diff_versions(BasicDatastructures const& other);
+
 private:
     // Calculates the distance between two coords c1 and c2
     Distance distance_between(Coord c1, Coord c2);
@@ -214,33 +399,145 @@ private:
     // Returns all direct and indirect parent regions of a region with id
     std::vector<RegionID> all_parents_of_region(RegionID id);
 
-    // Sturct for storing station data
+    // Sturct for storing station data, the id is the key in stations_to_ids.
+    // The coordinate and location are kept next to each other so that narrow
+    // traits types pack into one word.
     struct Station {
-        StationID id = NO_STATION;
-        Name name = NO_NAME;
+        Interned<Name> name;
         Coord coord = NO_COORD;
         RegionID location = NO_REGION;
-        std::set<std::pair<Time, TrainID>> departures = {};
+        // Sorted by time and train id
+        std::vector<std::pair<Time, TrainID>> departures = {};
+    };
+    // Geographical limits of a region, never modified after the region is
+    // added and so shared by all copies of its record
+    struct RegionShape {
+        std::vector<Coord> limits = {};
+        // Limits repacked for point-in-region tests: x and y coordinates in
+        // their own arrays with the first vertex repeated at the end, and the
+        // bounding box of the limits
+        std::vector<double> limit_xs = {};
+        std::vector<double> limit_ys = {};
+        Coord min_corner = NO_COORD;
+        Coord max_corner = NO_COORD;
     };
     // Node for a tree structure storing region data and relationships
     struct Region {
         RegionID id = NO_REGION;
         Name name = NO_NAME;
-        std::vector<Coord> limits = {};
-        Region* parent = nullptr;
-        std::vector<Region*> subregions = {};
+        std::shared_ptr<RegionShape const> shape = nullptr;
+        RegionID parent = NO_REGION;
+        std::vector<RegionID> subregions = {};
+    };
+
+    // Fills in the repacked limits of a region shape from its limits
+    static void pack_limits(RegionShape& shape);
+
+    // Returns a station/region record that is safe to modify in this version,
+    // or nullptr if there is no record with the id
+    template <typename IdText>
+    Station* writable_station(IdText const& id);
+    Region* writable_region(RegionID id);
+
+    // Saves a station interning its strings, false if the id exists
+    template <typename IdText, typename NameText>
+    bool insert_station(IdText&& id, NameText&& name, Coord xy);
+
+    // Saves a departure to a sorted departure vector, false if it already exists
+    static bool insert_departure(std::vector<std::pair<Time, TrainID>>& departures,
+                                 std::pair<Time, TrainID> departure);
+
+    // Estimates of the memory used by container internals
+    static std::size_t string_bytes(std::string const& str);
+    template <typename Number>
+    static std::size_t string_bytes(Number const&) { return 0; }
+    template <typename Value>
+    static std::size_t interned_bytes(Interned<Value> const& value);
+    // Reference counts of a make_shared allocation
+    static std::size_t const SHARED_RECORD_OVERHEAD = 2 * sizeof(void*);
+
+    // Moves the regions of the subtree of region id from old_depth to new_depth in
+    // regions_deepest_first
+    void set_subtree_depth(RegionID id, std::size_t old_depth, std::size_t new_depth);
+
+    // Stations/regions records hold the same values
+    static bool same_station(Station const& s1, Station const& s2);
+    static bool same_region(Region const& r1, Region const& r2);
+
+    // Appends the ids added, removed and changed in records compared to other_records
+    template <typename Map, typename Record, typename Id>
+    static void diff_records(Map const& records, Map const& other_records,
+                             bool (*same)(Record const&, Record const&),
+                             std::vector<Id>& added, std::vector<Id>& removed, std::vector<Id>& changed);
+
+    // Value of the name index, whose keys hold all its data
+    struct NoValue {};
+
+    // Orders the name set by name and id, a name alone is equivalent to the
+    // entries with that name
+    using NameKey = std::pair<Interned<Name>, Interned<StationID>>;
+    struct ByNameAndId {
+        using is_transparent = void;
+        bool operator()(NameKey const& k1, NameKey const& k2) const { return k1 < k2; }
+        template <typename NameText>
+        bool operator()(NameText const& name, NameKey const& k) const { return name < *k.first; }
+        template <typename NameText>
+        bool operator()(NameKey const& k, NameText const& name) const { return *k.first < name; }
     };
+
+    using StationMap = PersistentMap<Interned<StationID>, std::shared_ptr<Station>, InternedLess>;
+    using CoordMap = PersistentMap<Coord, Interned<StationID>>;
+    using NameSet = PersistentMap<NameKey, NoValue, ByNameAndId>;
+    using RegionMap = PersistentMap<RegionID, std::shared_ptr<Region>>;
+
+    // Orders depth, region id pairs deepest first and then by id
+    struct DeepestFirst {
+        bool operator()(std::pair<std::size_t, RegionID> const& r1,
+                        std::pair<std::size_t, RegionID> const& r2) const
+        {
+            return r1.first > r2.first || (r1.first == r2.first && r1.second < r2.second);
+        }
+    };
+    using RegionOrder = PersistentMap<std::pair<std::size_t, RegionID>,
+                                      std::shared_ptr<RegionShape const>, DeepestFirst>;
+
+    // The containers and the records in them are shared between forked
+    // versions, records are copied on their first modification (see
+    // writable_station and writable_region). The three station containers
+    // share one copy of each station id, and stations of the same name share
+    // one copy of the name.
+
     // Stations mapped to their IDs
-    std::unordered_map<StationID, std::shared_ptr<Station>> stations_to_ids;
+    StationMap stations_to_ids;
 
     // Station ids mapped to coords
-    std::map<Coord, StationID> station_ids_to_coords;
+    CoordMap station_ids_to_coords;
 
     // Station ids mapped to names
-    std::set<std::pair<Name, StationID>> station_ids_to_names;
+    NameSet station_ids_to_names;
 
     // Regions mapped to their IDs
-    std::unordered_map<RegionID, std::shared_ptr<Region>> regions_to_ids;
+    RegionMap regions_to_ids;
+
+    // Shapes of the regions with at least 3 limits keyed by their depth in
+    // the region tree, in the order regions_containing tests them
+    RegionOrder regions_deepest_first;
 };
 
+// The datastructure with the default types
+using Datastructures = BasicDatastructures<DefaultTraits>;
+
+// Counts the edges of a polygon crossed by a ray from (px, py) towards
+// positive x, the polygon is given as x and y arrays of n + 1 vertices
+// (see datastructures.cc)
+unsigned int edge_crossings(double const* xs, double const* ys, std::size_t n, double px, double py);
+
+#include "datastructures.tpp"
+
+// The datastructures with the provided traits are instantiated in
+// datastructures.cc, others where they are used
+extern template class BasicDatastructures<DefaultTraits>;
+extern template class BasicDatastructures<NumericIdTraits>;
+extern template class BasicDatastructures<Grid16Traits>;
+
 #endif // DATASTRUCTURES_HH
@@ -0,0 +1,1110 @@
+// Datastructures.tpp
+//
+// Student name:
+// Student email:
+// Student number:
+
+// Definitions of the BasicDatastructures members, included from
+// datastructures.hh so that the datastructure can be instantiated with any
+// traits
+
+#include <algorithm>
+
+/**
+ * @brief Datastructures::Datastructures constructor of the class
+ */
+template <typename Traits>
+BasicDatastructures<Traits>::BasicDatastructures()
+{}
+
+/**
+ * @brief Datastructures::~Datastructures destructor of the class
+ */
+template <typename Traits>
+BasicDatastructures<Traits>::~BasicDatastructures() {}
+
+/**
+ * @brief Datastructures::station_count counts all stations
+ * @return the number of stations saved to the datastructure
+ */
+template <typename Traits>
+unsigned int BasicDatastructures<Traits>::station_count()
+{
+    unsigned int station_count = stations_to_ids.size(); // O(1)
+    return station_count;
+}
+
+/**
+ * @brief Datastructures::clear_all clears all containers in the datastructure
+ */
+template <typename Traits>
+void BasicDatastructures<Traits>::clear_all()
+{
+    // Containers may be shared with forked versions, so they are replaced
+    // instead of cleared
+    stations_to_ids = StationMap(); // O(n)
+    regions_to_ids = RegionMap(); // O(n)
+    regions_deepest_first = RegionOrder(); // O(n)
+    station_ids_to_coords = CoordMap(); // O(n)
+    station_ids_to_names = NameSet(); // O(n)
+    return;
+}
+
+/**
+ * @brief Datastructures::all_stations lists all stations by their id
+ * @return vector containing ids for all stations saved to the datastructure
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::all_stations() -> std::vector<StationID>
+{
+    std::vector<StationID> all_ids;
+    for (const auto& station_to_id : stations_to_ids)
+    {
+        auto& id = station_to_id.first;
+        all_ids.push_back(id);
+    }
+    return all_ids;
+}
+
+/**
+ * @brief Datastructures::add_station saves a new station to the datastructure
+ * @param id the unique indentifier of the new station
+ * @param name the name of the new station
+ * @param xy the coordinates of the new station
+ * @return bool value indicating if saving the station was succesfull
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::add_station(StationID id, const Name& name, Coord xy)
+{
+    return insert_station(std::move(id), name, xy); // O(logn)
+}
+
+/**
+ * @brief Datastructures::get_station_name finds the name of the station with given id
+ * @param id the id of the station
+ * @return name of the station
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::get_station_name(StationID id) -> Name
+{
+    auto station = stations_to_ids.find(id); // O(logn)
+    if (station == nullptr)
+    {
+        return NO_NAME;
+    }
+    return (*station)->name;
+}
+
+/**
+ * @brief Datastructures::get_station_coordinates finds the coordinates of the station with given id
+ * @param id the id of the station
+ * @return the coordinates of the station
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::get_station_coordinates(StationID id) -> Coord
+{
+    auto station = stations_to_ids.find(id); // O(logn)
+    if (station == nullptr)
+    {
+        return NO_COORD;
+    }
+    return (*station)->coord;
+}
+
+/**
+ * @brief Datastructures::stations_alphabetically lists the ids of all stations sorted alphabetically by their names
+ * @return vector containing the sorted station ids
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::stations_alphabetically() -> std::vector<StationID>
+{
+    std::vector<StationID> sorted_stations;
+    sorted_stations.reserve(stations_to_ids.size());
+    for (const auto& id_to_name : station_ids_to_names) // O(n)
+    {
+        auto& id = id_to_name.first.second;
+        sorted_stations.push_back(id); // O(1)
+    }
+    return sorted_stations;
+}
+
+/**
+ * @brief Datastructures::stations_distance_increasing lists the ids of all stations sorted ascendingly by their coordinates
+ * @return vector containing the sorted station ids
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::stations_distance_increasing() -> std::vector<StationID>
+{
+    std::vector<StationID> sorted_stations;
+    sorted_stations.reserve(stations_to_ids.size());
+    for (const auto& id_to_coord : station_ids_to_coords) // O(n)
+    {
+        auto& id = id_to_coord.second;
+        sorted_stations.push_back(id); // O(1)
+    }
+    return sorted_stations;
+}
+
+/**
+ * @brief Datastructures::find_station_with_coord finds the id of a station located in given coordinates
+ * @param xy the coordinates where a station is searched from
+ * @return id of the found station
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::find_station_with_coord(Coord xy) -> StationID
+{
+    auto found_station = station_ids_to_coords.find(xy); // O(logn)
+    if (found_station == nullptr)
+    {
+        return NO_STATION;
+    }
+    return *found_station;
+}
+
+/**
+ * @brief Datastructures::change_station_coord changes the coordinates of a station with given id
+ * @param id the id of the station whose coordinates are to be changed
+ * @param newcoord the new coordinates of the station
+ * @return bool value indicating if changing coordinates was successful
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::change_station_coord(StationID id, Coord newcoord)
+{   
+    auto station = writable_station(id); // O(logn)
+    if (station == nullptr)
+    {
+        return false;
+    }
+    Coord& oldcoord = station->coord;
+    // Only one station is indexed for each coordinate, so the old coordinate
+    // may belong to another station
+    auto id_at_coord = station_ids_to_coords.find(oldcoord); // O(logn)
+    if (id_at_coord != nullptr && **id_at_coord == id)
+    {
+        station_ids_to_coords.erase(oldcoord); // O(logn)
+    }
+    auto& interned_id = stations_to_ids.find_entry(id)->first; // O(logn)
+    station_ids_to_coords.insert(newcoord, interned_id); // O(logn)
+    oldcoord = newcoord;
+
+    return true;
+}
+
+/**
+ * @brief Datastructures::add_departure saves a train departure for given station
+ * @param stationid the id of the station that the train departs from
+ * @param trainid the id of the train departing
+ * @param time the time of the departure
+ * @return bool value indicating if saving the departure was successful
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::add_departure(StationID stationid, TrainID trainid, Time time)
+{   
+    auto station = writable_station(stationid); // O(logn)
+    if (station == nullptr)
+    {
+        return false;
+    }
+    auto& departures = station->departures;
+
+    // O(logn) + O(d)
+    std::pair<Time, TrainID> new_departure = {time, std::move(trainid)};
+    auto add_success = insert_departure(departures, std::move(new_departure));
+
+    return add_success;
+}
+
+/**
+ * @brief Datastructures::remove_departure removes a train departure from a given station
+ * @param stationid the id of the station that the departure is removed from
+ * @param trainid the id of the train departing
+ * @param time the time of the departure
+ * @return bool value indicating if removing the departure was successful
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::remove_departure(StationID stationid, TrainID trainid, Time time)
+{    
+    auto station = writable_station(stationid); // O(logn)
+    if (station == nullptr)
+    {
+        return false;
+    }
+    auto& departures = station->departures;
+    std::pair<Time, TrainID> departure = {time, trainid};
+    auto departure_to_remove = std::lower_bound(departures.begin(), departures.end(), departure); // O(logn)
+    if (departure_to_remove == departures.end() || *departure_to_remove != departure)
+    {
+        return false;
+    }
+    departures.erase(departure_to_remove); // O(n)
+
+    return true;
+}
+
+/**
+ * @brief Datastructures::station_departures_after lists the departures from given station after given time
+ * @param stationid the id of the station whose departures are listed
+ * @param time the earliest time of the day for which departures are listed
+ * @return vector containing the departures as time, train pairs
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::station_departures_after(StationID stationid, Time time) -> std::vector<std::pair<Time, TrainID>>
+{
+    auto station = stations_to_ids.find(stationid); // O(logn)
+    if (station == nullptr)
+    {
+        return {{NO_TIME, NO_TRAIN}};
+    }
+    auto& all_departures = (*station)->departures; // d = number of departures
+
+    // Departures are sorted by time, so the first one at the given time is binary searched
+    auto first_dep = std::lower_bound(all_departures.begin(), all_departures.end(),
+                                      std::pair<Time, TrainID>(time, TrainID())); // O(logd)
+
+    int num_of_departures = std::distance(first_dep, all_departures.end()); // d - m operations
+    std::vector<std::pair<Time, TrainID>> timetable;
+    timetable.reserve(num_of_departures);
+
+    std::for_each(first_dep, all_departures.end(),
+                  [&timetable](auto departure){timetable.push_back(departure);}); // d - m operations
+
+    return timetable;
+}
+
+/**
+ * @brief Datastructures::add_region saves a new region to the datastructure
+ * @param id unique identifier of the new region
+ * @param name the name of the new region
+ * @param coords vector containing the geographical limits of the new region as coordinates
+ * @return bool value indicating if saving the new region was successful
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::add_region(RegionID id, const Name &name, std::vector<Coord> coords)
+{
+    if (regions_to_ids.find(id) != nullptr)
+    {
+        return false;
+    }
+    auto shape = std::make_shared<RegionShape>(RegionShape{std::move(coords)});
+    shape->limits.shrink_to_fit(); // O(c)
+    pack_limits(*shape); // O(c)
+    auto new_region = std::make_shared<Region>(Region{id, name, shape});
+    bool add_success = regions_to_ids.insert(id, new_region); // O(logn)
+    if (shape->limits.size() >= 3)
+    {
+        // A new region is not in the region tree yet, so it is at depth 0
+        regions_deepest_first.insert({0, id}, std::move(shape)); // O(logn)
+    }
+    return add_success;
+}
+
+/**
+ * @brief Datastructures::all_regions lists all regions by their id
+ * @return vector containing ids for all regions saved to the datastructure
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::all_regions() -> std::vector<RegionID>
+{
+    std::vector<RegionID> all_regions;
+    all_regions.reserve(regions_to_ids.size());
+    for (const auto& region : regions_to_ids) // O(n)
+    {
+        RegionID id = region.first;
+        all_regions.push_back(id); // O(1)
+    }
+    return all_regions;
+}
+
+/**
+ * @brief Datastructures::get_region_name finds the name of the region with given id
+ * @param id the id of the region
+ * @return name of the station
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::get_region_name(RegionID id) -> Name
+{
+    auto region = regions_to_ids.find(id); // O(logn)
+    if (region == nullptr)
+    {
+        return NO_NAME;
+    }
+    return (*region)->name;
+}
+
+/**
+ * @brief Datastructures::get_region_coords finds the coordinates bordering a given region
+ * @param id the id of the region
+ * @return vector containing the geographical limits of the region as coordinates
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::get_region_coords(RegionID id) -> std::vector<Coord>
+{
+    auto region = regions_to_ids.find(id); // O(logn)
+    if (region == nullptr)
+    {
+        return {NO_COORD};
+    }
+    return (*region)->shape->limits;
+}
+
+/**
+ * @brief Datastructures::add_subregion_to_region saves a parent-child relationship between two regions
+ * @param id the id of the region acting as subregion
+ * @param parentid the if of the region acting as parent region
+ * @return bool value indicating if saving the relationship was successful
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::add_subregion_to_region(RegionID id, RegionID parentid)
+{
+    auto region_ptr = regions_to_ids.find(id); // O(logn)
+    if (region_ptr == nullptr)
+    {
+        return false;
+    }
+    auto parent_ptr = regions_to_ids.find(parentid); // O(logn)
+    if (parent_ptr == nullptr)
+    {
+        return false;
+    }
+    if ((*region_ptr)->parent != NO_REGION)
+    {
+        return false;
+    }
+    std::size_t depth = all_parents_of_region(parentid).size(); // O(hlogn)
+    writable_region(id)->parent = parentid; // O(logn)
+    writable_region(parentid)->subregions.push_back(id); // O(1)
+    set_subtree_depth(id, 0, depth); // O(slogn)
+
+    return true;
+}
+
+/**
+ * @brief Datastructures::add_station_to_region saves a region the location for given station
+ * @param id the id of the station
+ * @param parentid the id of the region
+ * @return bool value indicating if saving the station-region relationship was successful
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::add_station_to_region(StationID id, RegionID parentid)
+{
+    auto station = stations_to_ids.find(id); // O(logn)
+    if (station == nullptr)
+    {
+        return false;
+    }
+    auto region = regions_to_ids.find(parentid); // O(logn)
+    if (region == nullptr)
+    {
+        return false;
+    }
+    if ((*station)->location != NO_REGION)
+    {
+        return false;
+    }
+    writable_station(id)->location = parentid; // O(logn)
+    return true;
+}
+
+/**
+ * @brief Datastructures::station_in_regions lists the regions that given station belogns to
+ * @param id the id of the station
+ * @return vector containing ids of all regions that the station belogns to
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::station_in_regions(StationID id) -> std::vector<RegionID>
+{
+    auto station = stations_to_ids.find(id); // O(logn)
+    if (station == nullptr)
+    {
+        return {NO_REGION};
+    }
+    auto& location = (*station)->location;
+    if (location == NO_REGION)
+    {
+        return {};
+    }
+    return all_parents_of_region(location);
+}
+
+/**
+ * @brief Datastructures::all_subregions_of_region lists all direct and indirect subregions for given region
+ * @param id the id of the region
+ * @return vector containing ids of all direct and indirect subregions
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::all_subregions_of_region(RegionID id) -> std::vector<RegionID>
+{
+    std::vector<RegionID> ids = {};
+    auto region = regions_to_ids.find(id); // O(logn)
+    if (region == nullptr)
+    {
+        return {NO_REGION};
+    }
+    auto& subregions = (*region)->subregions;
+    for (const auto& sub_id : subregions) // O(n)
+    {
+        ids.push_back(sub_id);
+        std::vector<RegionID> subsubs = all_subregions_of_region(sub_id);
+        ids.insert(ids.end(), subsubs.begin(), subsubs.end());
+    }
+    return ids;
+}
+
+/**
+ * @brief Datastructures::stations_closest_to finds 3 stations located closest to the given coordinate
+ * @param xy the coordinate for which the closest stations are searched
+ * @return vector containing ids for the 3 closest stations
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::stations_closest_to(Coord xy) -> std::vector<StationID>
+{
+    std::vector<StationID> closest_stations;
+    closest_stations.reserve(3);
+    std::map<Distance, std::set<std::pair<int, StationID>>> sorted_ids;
+
+    for (const auto& id_to_coord : station_ids_to_coords) // O(n)
+    {
+        auto& coord = id_to_coord.first;
+        int y_coord = coord.y;
+        auto& id = id_to_coord.second;
+        Distance distance = distance_between(coord, xy);
+        sorted_ids[distance].insert({y_coord, id}); // O(logn) + O(logn)
+    }
+    auto iter = sorted_ids.begin();
+    while (closest_stations.size() < 3 && iter != sorted_ids.end()) // O(3)
+    {
+        auto& ids_to_y_coords = iter->second;
+        for (auto& id_to_y_coord : ids_to_y_coords)
+        {
+            if (closest_stations.size() < 3)
+            {
+                auto& id = id_to_y_coord.second;
+                closest_stations.push_back(id);
+            }
+        }
+        ++iter;
+    }
+    return closest_stations;
+}
+
+/**
+ * @brief Datastructures::remove_station removes a station from the datastructure
+ * @param id the id of the station that is to be removed
+ * @return bool value indicating if the removal was successful
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::remove_station(StationID id)
+{
+    auto station = stations_to_ids.find_entry(id); // O(logn)
+    if (station == nullptr)
+     {
+        return false;
+    }
+    auto coord_to_remove = station->second->coord;
+    NameKey name_to_remove = {station->second->name, station->first};
+
+    auto id_at_coord = station_ids_to_coords.find(coord_to_remove); // O(logn)
+    if (id_at_coord != nullptr && **id_at_coord == id)
+    {
+        station_ids_to_coords.erase(coord_to_remove); // O(logn)
+    }
+    station_ids_to_names.erase(name_to_remove); // O(logn)
+    stations_to_ids.erase(id); // O(logn)
+
+    return true;
+}
+
+/**
+ * @brief Datastructures::common_parent_of_regions finds the common parent region nearest in tree hierarchy for two regions
+ * @param id1 the id of the first region
+ * @param id2 the id of the second region
+ * @return id of the nearest common parents of the two region
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::common_parent_of_regions(RegionID id1, RegionID id2) -> RegionID
+{
+    auto region1 = regions_to_ids.find(id1); // O(logn)
+    auto region2 = regions_to_ids.find(id2); // O(logn)
+
+    if (region1 == nullptr || region2 == nullptr)
+    {
+        return NO_REGION;
+    }
+    auto parent1 = (*region1)->parent;
+    auto parent2 = (*region2)->parent;
+
+    if (parent1 == NO_REGION || parent2 == NO_REGION)
+    {
+        return NO_REGION;
+    }
+    std::vector<RegionID> parents1 = all_parents_of_region(parent1); // O(n)
+    std::vector<RegionID> parents2 = all_parents_of_region(parent2); // O(n)
+
+    // O(a*b), where a and b are distances from regions 1 and 2 to root node, respectively
+    auto common_parent = std::find_first_of(parents1.begin(), parents1.end(),
+                                            parents2.begin(), parents2.end());
+    if (common_parent == parents1.end())
+    {
+        return NO_REGION;
+    }
+    return *common_parent;
+}
+
+/**
+ * @brief Datastructures::regions_containing finds the innermost region containing each of given coordinates
+ * @param coords the coordinates to classify
+ * @return vector containing for each coordinate the id of the innermost region, NO_REGION if not in any region
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::regions_containing(const std::vector<Coord>& coords) -> std::vector<RegionID>
+{
+    // Regions are tested from the deepest in the region tree, so the first
+    // region containing a coordinate is the innermost one
+    std::vector<std::pair<RegionID, RegionShape const*>> regions;
+    regions.reserve(regions_deepest_first.size());
+    for (const auto& depth_to_shape : regions_deepest_first) // O(r)
+    {
+        regions.push_back({depth_to_shape.first.second, depth_to_shape.second.get()});
+    }
+
+    std::vector<RegionID> containing_regions;
+    containing_regions.reserve(coords.size());
+    for (const auto& xy : coords) // O(p)
+    {
+        RegionID containing_region = NO_REGION;
+        for (const auto& id_to_shape : regions) // O(r)
+        {
+            auto& shape = *id_to_shape.second;
+            if (xy.x < shape.min_corner.x || xy.x > shape.max_corner.x
+                    || xy.y < shape.min_corner.y || xy.y > shape.max_corner.y)
+            {
+                continue;
+            }
+            // O(c)
+            unsigned int crossings = edge_crossings(shape.limit_xs.data(), shape.limit_ys.data(),
+                                                    shape.limits.size(), xy.x, xy.y);
+            if (crossings % 2 == 1)
+            {
+                containing_region = id_to_shape.first;
+                break;
+            }
+        }
+        containing_regions.push_back(containing_region);
+    }
+    return containing_regions;
+}
+
+/**
+ * @brief Datastructures::distance_between calculates the euclidean distance between two coordinates
+ * @param c1 first coordinate
+ * @param c2 second coordinate
+ * @return the distance between the two coordinates
+ */
+template <typename Traits>
+Distance BasicDatastructures<Traits>::distance_between(Coord c1, Coord c2)
+{
+    Distance distance = hypot(c1.x - c2.x, c1.y - c2.y);
+    return abs(distance);
+}
+
+/**
+ * @brief Datastructures::add_stations saves a batch of new stations to the datastructure
+ * @param stations the ids, names and coordinates of the new stations
+ * @return the number of stations saved, stations whose id exists are skipped
+ */
+template <typename Traits>
+template <typename IdText, typename NameText>
+unsigned int BasicDatastructures<Traits>::add_stations(std::vector<std::tuple<IdText, NameText, Coord>> stations)
+{
+    unsigned int added = 0;
+    for (auto& [id, name, xy] : stations) // O(n)
+    {
+        if (insert_station(std::move(id), std::move(name), xy)) // O(logn)
+        {
+            ++added;
+        }
+    }
+    return added;
+}
+
+/**
+ * @brief Datastructures::add_departures saves a batch of train departures
+ * @param departures the station ids, train ids and times of the departures
+ * @return the number of departures saved, departures from unknown stations and existing departures are skipped
+ */
+template <typename Traits>
+template <typename IdText, typename TrainText>
+unsigned int BasicDatastructures<Traits>::add_departures(std::vector<std::tuple<IdText, TrainText, Time>> departures)
+{
+    // The departures of each station are saved together, so that each
+    // station is searched once and its departures are sorted once, instead
+    // of inserting each departure in order. The loaders sort their batches
+    // by station while parsing.
+    auto by_station = [](const auto& departure1, const auto& departure2)
+    {
+        return std::get<0>(departure1) < std::get<0>(departure2);
+    };
+    if (!std::is_sorted(departures.begin(), departures.end(), by_station)) // O(n)
+    {
+        std::sort(departures.begin(), departures.end(), by_station); // O(nlogn)
+    }
+
+    unsigned int added = 0;
+    auto first = departures.begin();
+    while (first != departures.end()) // O(n)
+    {
+        auto& stationid = std::get<0>(*first);
+        auto last = std::find_if(first, departures.end(), [&stationid](const auto& departure)
+        {
+            return std::get<0>(departure) != stationid;
+        });
+        Station* station = writable_station(stationid); // O(logn)
+        if (station == nullptr)
+        {
+            first = last;
+            continue;
+        }
+        auto& station_departures = station->departures;
+        std::size_t old_count = station_departures.size();
+        for (; first != last; ++first) // O(k), k = new departures
+        {
+            station_departures.emplace_back(std::get<2>(*first), TrainID(std::move(std::get<1>(*first))));
+        }
+        auto first_new = station_departures.begin() + old_count;
+        if (!std::is_sorted(first_new, station_departures.end())) // O(k)
+        {
+            std::sort(first_new, station_departures.end()); // O(klogk)
+        }
+        std::inplace_merge(station_departures.begin(), first_new, station_departures.end()); // O(d)
+        station_departures.erase(std::unique(station_departures.begin(), station_departures.end()),
+                                 station_departures.end()); // O(d)
+        added += station_departures.size() - old_count;
+    }
+    return added;
+}
+
+/**
+ * @brief Datastructures::memory_usage estimates the memory used by each container of the datastructure
+ * @return estimated bytes used by the containers and the records in them
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::memory_usage() -> MemoryUsage
+{
+    MemoryUsage usage;
+
+    for (const auto& station : stations_to_ids) // O(n)
+    {
+        usage.station_index += StationMap::NODE_BYTES + interned_bytes(station.first);
+        usage.station_records += SHARED_RECORD_OVERHEAD + sizeof(Station);
+        auto& departures = station.second->departures;
+        usage.departures += departures.capacity() * sizeof(std::pair<Time, TrainID>);
+        for (const auto& departure : departures) // O(d)
+        {
+            usage.departures += string_bytes(departure.second);
+        }
+    }
+    usage.coord_index += station_ids_to_coords.size() * CoordMap::NODE_BYTES;
+    // Names are shared by the stations of the same name, which are next to
+    // each other in the name set
+    Name const* previous_name = nullptr;
+    std::size_t owned_copies = 0;
+    std::size_t interned = 0;
+    for (const auto& id_to_name : station_ids_to_names) // O(n)
+    {
+        auto& name = id_to_name.first.first;
+        auto& id = id_to_name.first.second;
+        usage.name_index += NameSet::NODE_BYTES;
+        if (previous_name != &*name)
+        {
+            usage.name_index += interned_bytes(name);
+            interned += interned_bytes(name);
+        }
+        previous_name = &*name;
+
+        // Without interning, the id would be kept by the three station
+        // containers and the name by the station record and the name set
+        owned_copies += 3 * (sizeof(StationID) + string_bytes(*id)) + 2 * (sizeof(Name) + string_bytes(*name));
+        interned += 3 * sizeof(Interned<StationID>) + 2 * sizeof(Interned<Name>) + interned_bytes(id);
+    }
+    usage.interned_savings = static_cast<std::ptrdiff_t>(owned_copies) - static_cast<std::ptrdiff_t>(interned);
+
+    for (const auto& region : regions_to_ids) // O(n)
+    {
+        usage.region_index += RegionMap::NODE_BYTES;
+        if (region.second->shape->limits.size() >= 3)
+        {
+            usage.region_index += RegionOrder::NODE_BYTES;
+        }
+        usage.region_records += SHARED_RECORD_OVERHEAD + sizeof(Region)
+                + string_bytes(region.second->name)
+                + region.second->subregions.capacity() * sizeof(RegionID);
+        auto& shape = *region.second->shape;
+        usage.region_limits += SHARED_RECORD_OVERHEAD + sizeof(RegionShape)
+                + shape.limits.capacity() * sizeof(Coord)
+                + (shape.limit_xs.capacity() + shape.limit_ys.capacity()) * sizeof(double);
+    }
+    return usage;
+}
+
+/**
+ * @brief Datastructures::compact releases unused capacity from the containers and records of this version
+ */
+template <typename Traits>
+void BasicDatastructures<Traits>::compact()
+{
+    // Records shared with other versions are left as they are, copying them
+    // here would use more memory than compacting saves
+    stations_to_ids.for_each_unshared([](const StationID&, std::shared_ptr<Station>& station) // O(n)
+    {
+        if (station.use_count() == 1)
+        {
+            // The interned name may be shared with other stations, it is not modified
+            station->departures.shrink_to_fit(); // O(d)
+        }
+    });
+    regions_to_ids.for_each_unshared([](RegionID, std::shared_ptr<Region>& region) // O(n)
+    {
+        if (region.use_count() == 1)
+        {
+            // Region shapes are shrunk when they are created
+            region->name.shrink_to_fit();
+            region->subregions.shrink_to_fit();
+        }
+    });
+}
+
+/**
+ * @brief Datastructures::fork creates a new version of the datastructure for what-if edits
+ * @return a version sharing all data with this one until either of them is modified
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::fork() -> BasicDatastructures
+{
+    return *this;
+}
+
+/**
+ * @brief Datastructures::move_subregion_to_region changes the parent region of a region
+ * @param id the id of the region acting as subregion
+ * @param parentid the id of the new parent region
+ * @return bool value indicating if moving the region was successful
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::move_subregion_to_region(RegionID id, RegionID parentid)
+{
+    auto region_ptr = regions_to_ids.find(id); // O(logn)
+    if (region_ptr == nullptr)
+    {
+        return false;
+    }
+    if (regions_to_ids.find(parentid) == nullptr) // O(logn)
+    {
+        return false;
+    }
+    // A region can not be moved under itself or any of its own subregions
+    std::vector<RegionID> new_parents = all_parents_of_region(parentid); // O(n)
+    if (std::find(new_parents.begin(), new_parents.end(), id) != new_parents.end())
+    {
+        return false;
+    }
+    RegionID old_parent = (*region_ptr)->parent;
+    if (old_parent == parentid)
+    {
+        return true;
+    }
+    std::size_t old_depth = all_parents_of_region(id).size() - 1; // O(hlogn)
+    if (old_parent != NO_REGION)
+    {
+        auto& siblings = writable_region(old_parent)->subregions;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), id)); // O(n)
+    }
+    writable_region(id)->parent = parentid;
+    writable_region(parentid)->subregions.push_back(id); // O(1)
+    set_subtree_depth(id, old_depth, new_parents.size()); // O(slogn)
+
+    return true;
+}
+
+/**
+ * @brief Datastructures::diff_versions lists the stations and regions that differ between two versions
+ * @param other the version this one is compared to
+ * @return added, removed and changed stations and regions as seen from this version
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::diff_versions(const BasicDatastructures& other) -> VersionDiff
+{
+    VersionDiff diff;
+
+    // Containers still shared by the versions can not differ
+    if (!stations_to_ids.same_as(other.stations_to_ids))
+    {
+        diff_records(stations_to_ids, other.stations_to_ids, &same_station,
+                     diff.added_stations, diff.removed_stations, diff.changed_stations); // O(n)
+    }
+    if (!regions_to_ids.same_as(other.regions_to_ids))
+    {
+        diff_records(regions_to_ids, other.regions_to_ids, &same_region,
+                     diff.added_regions, diff.removed_regions, diff.changed_regions); // O(n)
+    }
+    return diff;
+}
+
+/**
+ * @brief Datastructures::diff_records compares the records of two versions of a container
+ * @param records the records of this version
+ * @param other_records the records of the other version
+ * @param same checks if two records hold the same data
+ * @param added ids found only in this version are appended here
+ * @param removed ids found only in the other version are appended here
+ * @param changed ids whose records differ are appended here
+ */
+template <typename Traits>
+template <typename Map, typename Record, typename Id>
+void BasicDatastructures<Traits>::diff_records(const Map& records, const Map& other_records,
+                                               bool (*same)(const Record&, const Record&),
+                                               std::vector<Id>& added, std::vector<Id>& removed,
+                                               std::vector<Id>& changed)
+{
+    // Both containers are sorted by id, so they are walked side by side
+    auto record = records.begin();
+    auto other_record = other_records.begin();
+    while (record != records.end() || other_record != other_records.end()) // O(n)
+    {
+        if (other_record == other_records.end()
+                || (record != records.end() && record->first < other_record->first))
+        {
+            added.push_back(record->first);
+            ++record;
+        }
+        else if (record == records.end() || other_record->first < record->first)
+        {
+            removed.push_back(other_record->first);
+            ++other_record;
+        }
+        else
+        {
+            if (record->second != other_record->second && !same(*record->second, *other_record->second))
+            {
+                changed.push_back(record->first);
+            }
+            ++record;
+            ++other_record;
+        }
+    }
+}
+
+/**
+ * @brief Datastructures::all_parents_of_region finds all regions that given region belogns to directly or indirectly
+ * @param id the id of the region
+ * @return vector containing ids for all regions that the subregion belogns to
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::all_parents_of_region(RegionID id) -> std::vector<RegionID>
+{
+    std::vector<RegionID> all_parents;
+
+    RegionID current_region = id;
+
+    // loop runs r times, where r is the distance from region node to root
+    while (current_region != NO_REGION)
+    {
+        all_parents.push_back(current_region);
+        current_region = (*regions_to_ids.find(current_region))->parent; // O(logn)
+    }
+    return all_parents;
+}
+
+
+/**
+ * @brief Datastructures::writable_station gives a station record that can be modified without affecting other versions
+ * @param id the id of the station
+ * @return pointer to the station record owned by this version, nullptr if the station was not found
+ */
+template <typename Traits>
+template <typename IdText>
+auto BasicDatastructures<Traits>::writable_station(const IdText& id) -> Station*
+{
+    auto station = stations_to_ids.find_writable(id); // O(logn)
+    if (station == nullptr)
+    {
+        return nullptr;
+    }
+    if (station->use_count() > 1)
+    {
+        *station = std::make_shared<Station>(**station); // O(d)
+    }
+    return station->get();
+}
+
+/**
+ * @brief Datastructures::writable_region gives a region record that can be modified without affecting other versions
+ * @param id the id of the region
+ * @return pointer to the region record owned by this version, nullptr if the region was not found
+ */
+template <typename Traits>
+auto BasicDatastructures<Traits>::writable_region(RegionID id) -> Region*
+{
+    auto region = regions_to_ids.find_writable(id); // O(logn)
+    if (region == nullptr)
+    {
+        return nullptr;
+    }
+    if (region->use_count() > 1)
+    {
+        *region = std::make_shared<Region>(**region); // O(s), s = number of subregions, the shape is shared
+    }
+    return region->get();
+}
+
+/**
+ * @brief Datastructures::set_subtree_depth moves a subtree of the region tree to a new depth in the testing order of regions_containing
+ * @param id the id of the root region of the subtree
+ * @param old_depth the depth of the region before it was moved
+ * @param new_depth the depth of the region after it was moved
+ */
+template <typename Traits>
+void BasicDatastructures<Traits>::set_subtree_depth(RegionID id, std::size_t old_depth, std::size_t new_depth)
+{
+    auto& region = **regions_to_ids.find(id); // O(logn)
+    if (region.shape->limits.size() >= 3)
+    {
+        regions_deepest_first.erase({old_depth, id}); // O(logn)
+        regions_deepest_first.insert({new_depth, id}, region.shape); // O(logn)
+    }
+    for (auto subregion : region.subregions) // O(s)
+    {
+        set_subtree_depth(subregion, old_depth + 1, new_depth + 1);
+    }
+}
+
+/**
+ * @brief Datastructures::same_station checks if two station records hold the same data
+ * @param s1 first station
+ * @param s2 second station
+ * @return bool value indicating if the records are equal
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::same_station(const Station& s1, const Station& s2)
+{
+    return s1.name == s2.name && s1.coord == s2.coord
+            && s1.location == s2.location && s1.departures == s2.departures;
+}
+
+/**
+ * @brief Datastructures::same_region checks if two region records hold the same data
+ * @param r1 first region
+ * @param r2 second region
+ * @return bool value indicating if the records are equal
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::same_region(const Region& r1, const Region& r2)
+{
+    return r1.name == r2.name && r1.parent == r2.parent
+            && (r1.shape == r2.shape
+                || std::equal(r1.shape->limits.begin(), r1.shape->limits.end(),
+                              r2.shape->limits.begin(), r2.shape->limits.end()))
+            && r1.subregions == r2.subregions;
+}
+
+/**
+ * @brief Datastructures::insert_station saves a new station, moving its id and name into the containers
+ * @param id the unique indentifier of the new station
+ * @param name the name of the new station
+ * @param xy the coordinates of the new station
+ * @return bool value indicating if saving the station was succesfull
+ */
+template <typename Traits>
+template <typename IdText, typename NameText>
+bool BasicDatastructures<Traits>::insert_station(IdText&& id, NameText&& name, Coord xy)
+{
+    if (stations_to_ids.find(id) != nullptr) // O(logn)
+    {
+        return false;
+    }
+    // The containers share one copy of the id, and the name is shared with a
+    // station of the same name if there is one
+    Interned<StationID> interned_id(StationID(std::forward<IdText>(id)));
+    auto same_name = station_ids_to_names.find_entry(name); // O(logn)
+    Interned<Name> interned_name = same_name != nullptr ? same_name->first.first
+                                                        : Interned<Name>(Name(std::forward<NameText>(name)));
+    station_ids_to_coords.insert(xy, interned_id); // O(logn)
+    station_ids_to_names.insert({interned_name, interned_id}, NoValue()); // O(logn)
+    auto new_station = std::make_shared<Station>(Station{std::move(interned_name), xy});
+    stations_to_ids.insert(std::move(interned_id), std::move(new_station)); // O(logn)
+    return true;
+}
+
+/**
+ * @brief Datastructures::insert_departure saves a departure keeping the departures sorted
+ * @param departures the sorted departures of a station
+ * @param departure the new departure
+ * @return bool value indicating if the departure was new
+ */
+template <typename Traits>
+bool BasicDatastructures<Traits>::insert_departure(std::vector<std::pair<Time, TrainID>>& departures,
+                                                   std::pair<Time, TrainID> departure)
+{
+    auto position = std::lower_bound(departures.begin(), departures.end(), departure); // O(logd)
+    if (position != departures.end() && *position == departure)
+    {
+        return false;
+    }
+    departures.insert(position, std::move(departure)); // O(d), O(1) when departures are added in time order
+    return true;
+}
+
+/**
+ * @brief Datastructures::pack_limits repacks the limits of a region for the point-in-region kernels
+ * @param shape the region shape whose limits are repacked
+ */
+template <typename Traits>
+void BasicDatastructures<Traits>::pack_limits(RegionShape& shape)
+{
+    auto& limits = shape.limits;
+    shape.limit_xs.clear();
+    shape.limit_ys.clear();
+    if (limits.empty())
+    {
+        return;
+    }
+    shape.limit_xs.reserve(limits.size() + 1);
+    shape.limit_ys.reserve(limits.size() + 1);
+    shape.min_corner = shape.max_corner = limits.front();
+    for (const auto& xy : limits) // O(c)
+    {
+        shape.limit_xs.push_back(xy.x);
+        shape.limit_ys.push_back(xy.y);
+        shape.min_corner = {std::min(shape.min_corner.x, xy.x), std::min(shape.min_corner.y, xy.y)};
+        shape.max_corner = {std::max(shape.max_corner.x, xy.x), std::max(shape.max_corner.y, xy.y)};
+    }
+    shape.limit_xs.push_back(limits.front().x);
+    shape.limit_ys.push_back(limits.front().y);
+}
+
+/**
+ * @brief Datastructures::string_bytes estimates the heap memory used by a string
+ * @param str the string
+ * @return bytes allocated by the string, 0 for strings stored inside the string object
+ */
+template <typename Traits>
+std::size_t BasicDatastructures<Traits>::string_bytes(const std::string& str)
+{
+    static std::size_t const inline_capacity = std::string().capacity();
+    return str.capacity() > inline_capacity ? str.capacity() + 1 : 0;
+}
+
+/**
+ * @brief Datastructures::interned_bytes estimates the memory used by the shared copy of an interned value
+ * @param value the interned value
+ * @return bytes allocated for the shared copy, 0 for numbers stored by value
+ */
+template <typename Traits>
+template <typename Value>
+std::size_t BasicDatastructures<Traits>::interned_bytes(const Interned<Value>& value)
+{
+    if (Interned<Value>::SHARED_BYTES == 0)
+    {
+        return 0;
+    }
+    return Interned<Value>::SHARED_BYTES + string_bytes(*value);
+}
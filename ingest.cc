@@ -0,0 +1,517 @@
+// Ingest.cc
+//
+// Student name:
+// Student email:
+// Student number:
+
+#include "ingest.hh"
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+// Read-only memory mapping of a whole file, unmapped when destroyed
+class MappedFile
+{
+public:
+    explicit MappedFile(std::string const& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) == 0)
+        {
+            size = info.st_size;
+            opened = true;
+            if (size > 0)
+            {
+                void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED)
+                {
+                    opened = false;
+                    size = 0;
+                }
+                else
+                {
+                    data = static_cast<char const*>(mapped);
+                    ::madvise(mapped, size, MADV_SEQUENTIAL);
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (data != nullptr)
+        {
+            ::munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    bool is_open() const { return opened; }
+    std::string_view contents() const { return {data, size}; }
+
+private:
+    char const* data = nullptr;
+    std::size_t size = 0;
+    bool opened = false;
+};
+
+// Records parsed from the files, string fields point to the mapped file
+struct StationRecord {
+    std::string_view id;
+    std::string_view name;
+    Coord xy;
+};
+struct RegionRecord {
+    RegionID id = NO_REGION;
+    std::string_view name;
+    std::vector<Coord> coords;
+};
+struct RegionLinkRecord {
+    RegionID id = NO_REGION;
+    RegionID parentid = NO_REGION;
+};
+struct StationLinkRecord {
+    std::string_view id;
+    RegionID parentid = NO_REGION;
+};
+struct DepartureRecord {
+    std::string_view stationid;
+    std::string_view trainid;
+    Time time = NO_TIME;
+};
+
+// Records parsed from one chunk of a file
+template <typename Record>
+struct ParsedChunk {
+    std::vector<Record> records = {};
+    unsigned int rejected = 0;
+};
+
+/**
+ * @brief next_field cuts the text up to the next separator from the front of a line
+ * @param line the rest of the line, the field and the separator are removed from it
+ * @param separator the character ending the field
+ * @return the field without the separator
+ */
+std::string_view next_field(std::string_view& line, char separator = ';')
+{
+    auto end = line.find(separator);
+    std::string_view field = line.substr(0, end);
+    line.remove_prefix(end == std::string_view::npos ? line.size() : end + 1);
+    return field;
+}
+
+/**
+ * @brief parse_number reads a whole field as an integer
+ * @param field the text of the field
+ * @param value the parsed value
+ * @return bool value indicating if the field was a valid number
+ */
+template <typename Number>
+bool parse_number(std::string_view field, Number& value)
+{
+    auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+/**
+ * @brief parse_coord reads a field of form x,y as a coordinate
+ * @param field the text of the field
+ * @param xy the parsed coordinate
+ * @return bool value indicating if the field was a valid coordinate
+ */
+bool parse_coord(std::string_view field, Coord& xy)
+{
+    std::string_view x = next_field(field, ',');
+    return parse_number(x, xy.x) && parse_number(field, xy.y);
+}
+
+/**
+ * @brief parse_line reads one line of a file to a record, overloaded for each file format
+ * @param line the line without the line break
+ * @param record the parsed record
+ * @return bool value indicating if the line was valid
+ */
+bool parse_line(std::string_view line, StationRecord& record)
+{
+    record.id = next_field(line);
+    record.name = next_field(line);
+    return !record.id.empty() && parse_coord(line, record.xy);
+}
+
+bool parse_line(std::string_view line, RegionRecord& record)
+{
+    if (!parse_number(next_field(line), record.id))
+    {
+        return false;
+    }
+    record.name = next_field(line);
+    while (!line.empty())
+    {
+        Coord xy;
+        if (!parse_coord(next_field(line), xy))
+        {
+            return false;
+        }
+        record.coords.push_back(xy);
+    }
+    return true;
+}
+
+bool parse_line(std::string_view line, RegionLinkRecord& record)
+{
+    return parse_number(next_field(line), record.id) && parse_number(line, record.parentid);
+}
+
+bool parse_line(std::string_view line, StationLinkRecord& record)
+{
+    record.id = next_field(line);
+    return !record.id.empty() && parse_number(line, record.parentid);
+}
+
+bool parse_line(std::string_view line, DepartureRecord& record)
+{
+    record.stationid = next_field(line);
+    record.trainid = next_field(line);
+    return !record.stationid.empty() && !record.trainid.empty() && parse_number(line, record.time);
+}
+
+/**
+ * @brief parse_chunk parses all lines of a chunk that ends at a line boundary
+ * @param chunk the text of the chunk
+ * @return the records parsed and the number of malformed lines
+ */
+template <typename Record>
+ParsedChunk<Record> parse_chunk(std::string_view chunk)
+{
+    ParsedChunk<Record> parsed;
+    while (!chunk.empty())
+    {
+        std::string_view line = next_field(chunk, '\n');
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+        Record record;
+        if (parse_line(line, record))
+        {
+            parsed.records.push_back(std::move(record));
+        }
+        else
+        {
+            ++parsed.rejected;
+        }
+    }
+    return parsed;
+}
+
+/**
+ * @brief arrange_records orders the records of a parsed chunk for saving, overloaded for each record type
+ * @param records the records of the chunk
+ */
+template <typename Record>
+void arrange_records(std::vector<Record>&)
+{
+    // Records are saved in the order they appear in the file
+}
+
+void arrange_records(std::vector<DepartureRecord>& records)
+{
+    // add_departures saves the departures of each station together and
+    // sorts them by time and train, the sorting is done here by the parsing
+    // threads instead
+    std::sort(records.begin(), records.end(), [](const auto& r1, const auto& r2)
+    {
+        return std::tie(r1.stationid, r1.time, r1.trainid) < std::tie(r2.stationid, r2.time, r2.trainid);
+    });
+}
+
+/**
+ * @brief split_file splits the text of a file to chunks ending at line breaks
+ * @param contents the whole text of the file
+ * @return the chunks in the order they appear in the file
+ */
+std::vector<std::string_view> split_file(std::string_view contents)
+{
+    // Chunks are small enough that saving can start soon after the first
+    // one is parsed, and large enough that handing them out is cheap
+    std::size_t const chunk_size = 1 << 22;
+
+    // Chunk borders are moved forward to the next line break
+    std::vector<std::string_view> chunks;
+    std::size_t begin = 0;
+    while (begin < contents.size())
+    {
+        std::size_t end = contents.size();
+        if (contents.size() - begin > chunk_size)
+        {
+            end = contents.find('\n', begin + chunk_size);
+            end = end == std::string_view::npos ? contents.size() : end + 1;
+        }
+        chunks.push_back(contents.substr(begin, end - begin));
+        begin = end;
+    }
+    return chunks;
+}
+
+// Parses the chunks of a file with worker threads while the caller saves
+// the chunks parsed before them. The chunks are handed to the caller in
+// file order, and the workers parse at most a window of chunks ahead of the
+// caller, so the parsed records of the whole file are not held at once.
+template <typename Record>
+class ChunkPipeline
+{
+public:
+    ChunkPipeline(std::vector<std::string_view> const& chunks, unsigned int thread_count) :
+        chunks(chunks), parsed(chunks.size()), ready(chunks.size(), false), window(2 * thread_count)
+    {
+        for (unsigned int i = 0; i < thread_count; ++i)
+        {
+            workers.emplace_back([this]() { parse_chunks(); });
+        }
+    }
+
+    ~ChunkPipeline()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        changed.notify_all();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ChunkPipeline(ChunkPipeline const&) = delete;
+    ChunkPipeline& operator=(ChunkPipeline const&) = delete;
+
+    // Waits until the next chunk in file order is parsed and takes it
+    ParsedChunk<Record> next()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return ready[taken]; });
+        ParsedChunk<Record> chunk = std::move(parsed[taken]);
+        ++taken;
+        lock.unlock();
+        changed.notify_all();
+        return chunk;
+    }
+
+private:
+    // Run by each worker until all chunks are parsed
+    void parse_chunks()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            changed.wait(lock, [this]()
+            {
+                return stopped || unparsed == chunks.size() || unparsed < taken + window;
+            });
+            if (stopped || unparsed == chunks.size())
+            {
+                return;
+            }
+            std::size_t i = unparsed++;
+            lock.unlock();
+            ParsedChunk<Record> chunk = parse_chunk<Record>(chunks[i]);
+            arrange_records(chunk.records);
+            lock.lock();
+            parsed[i] = std::move(chunk);
+            ready[i] = true;
+            changed.notify_all();
+        }
+    }
+
+    std::vector<std::string_view> const& chunks;
+    std::vector<ParsedChunk<Record>> parsed;
+    std::vector<bool> ready;
+    std::size_t const window;
+
+    // Guard the fields below and ready and parsed
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t unparsed = 0; // the first chunk no worker has started
+    std::size_t taken = 0;    // the first chunk not taken by the caller
+    bool stopped = false;
+
+    std::vector<std::thread> workers;
+};
+
+/**
+ * @brief load_file maps a file and passes its parsed chunks to a saving function
+ * @param path the path of the file
+ * @param thread_count the number of threads used for parsing
+ * @param save function saving the records of a chunk, returns the number of records saved
+ * @return report of the loaded file
+ */
+template <typename Record, typename SaveFunction>
+DatasetLoader::Report load_file(std::string const& path, unsigned int thread_count, SaveFunction save)
+{
+    DatasetLoader::Report report;
+    MappedFile file(path);
+    if (!file.is_open())
+    {
+        return report;
+    }
+    report.opened = true;
+    auto save_chunk = [&report, &save](ParsedChunk<Record>& chunk)
+    {
+        unsigned int added = save(chunk.records);
+        report.added += added;
+        report.rejected += chunk.rejected + (chunk.records.size() - added);
+    };
+
+    std::vector<std::string_view> chunks = split_file(file.contents());
+    // Small files are not worth starting threads for
+    if (chunks.size() == 1)
+    {
+        ParsedChunk<Record> chunk = parse_chunk<Record>(chunks.front());
+        arrange_records(chunk.records);
+        save_chunk(chunk);
+        return report;
+    }
+    // Each chunk is saved while the workers parse the chunks after it
+    ChunkPipeline<Record> pipeline(chunks, thread_count);
+    for (std::size_t i = 0; i < chunks.size(); ++i)
+    {
+        ParsedChunk<Record> chunk = pipeline.next();
+        save_chunk(chunk);
+    }
+    return report;
+}
+
+}
+
+/**
+ * @brief DatasetLoader::DatasetLoader constructor of the class
+ * @param ds the datastructure the loaded records are saved to
+ * @param threads the number of threads parsing a file while it is saved
+ */
+DatasetLoader::DatasetLoader(Datastructures& ds, unsigned int threads) :
+    datastructures(ds), thread_count(std::max(threads, 1u))
+{}
+
+/**
+ * @brief DatasetLoader::load_stations loads stations from a file
+ * @param path the path of the file
+ * @return report of the loaded file
+ */
+DatasetLoader::Report DatasetLoader::load_stations(const std::string& path)
+{
+    return load_file<StationRecord>(path, thread_count, [this](auto& records)
+    {
+        std::vector<std::tuple<std::string_view, std::string_view, Coord>> stations;
+        stations.reserve(records.size());
+        for (const auto& record : records)
+        {
+            stations.emplace_back(record.id, record.name, record.xy);
+        }
+        return datastructures.add_stations(std::move(stations));
+    });
+}
+
+/**
+ * @brief DatasetLoader::load_regions loads regions and their limits from a file
+ * @param path the path of the file
+ * @return report of the loaded file
+ */
+DatasetLoader::Report DatasetLoader::load_regions(const std::string& path)
+{
+    return load_file<RegionRecord>(path, thread_count, [this](auto& records)
+    {
+        unsigned int added = 0;
+        for (auto& record : records)
+        {
+            if (datastructures.add_region(record.id, Name(record.name), std::move(record.coords)))
+            {
+                ++added;
+            }
+        }
+        return added;
+    });
+}
+
+/**
+ * @brief DatasetLoader::load_subregions loads the region hierarchy from a file
+ * @param path the path of the file
+ * @return report of the loaded file
+ */
+DatasetLoader::Report DatasetLoader::load_subregions(const std::string& path)
+{
+    return load_file<RegionLinkRecord>(path, thread_count, [this](auto& records)
+    {
+        unsigned int added = 0;
+        for (const auto& record : records)
+        {
+            if (datastructures.add_subregion_to_region(record.id, record.parentid))
+            {
+                ++added;
+            }
+        }
+        return added;
+    });
+}
+
+/**
+ * @brief DatasetLoader::load_station_regions loads the regions of stations from a file
+ * @param path the path of the file
+ * @return report of the loaded file
+ */
+DatasetLoader::Report DatasetLoader::load_station_regions(const std::string& path)
+{
+    return load_file<StationLinkRecord>(path, thread_count, [this](auto& records)
+    {
+        unsigned int added = 0;
+        for (const auto& record : records)
+        {
+            if (datastructures.add_station_to_region(StationID(record.id), record.parentid))
+            {
+                ++added;
+            }
+        }
+        return added;
+    });
+}
+
+/**
+ * @brief DatasetLoader::load_departures loads train departures from a file
+ * @param path the path of the file
+ * @return report of the loaded file
+ */
+DatasetLoader::Report DatasetLoader::load_departures(const std::string& path)
+{
+    return load_file<DepartureRecord>(path, thread_count, [this](auto& records)
+    {
+        std::vector<std::tuple<std::string_view, std::string_view, Time>> departures;
+        departures.reserve(records.size());
+        for (const auto& record : records)
+        {
+            departures.emplace_back(record.stationid, record.trainid, record.time);
+        }
+        return datastructures.add_departures(std::move(departures));
+    });
+}
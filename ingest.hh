@@ -0,0 +1,79 @@
+// Ingest.hh
+//
+// Student name:
+// Student email:
+// Student number:
+
+#ifndef INGEST_HH
+#define INGEST_HH
+
+#include "datastructures.hh"
+
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Loads stations, regions and departures from text files to a Datastructures.
+//
+// The files are memory mapped and split to chunks of a few megabytes at line
+// boundaries. Worker threads parse the chunks with fields kept as views to
+// the mapped file, while the calling thread saves the chunks parsed before
+// with the batched insertion operations, in the order they appear in the
+// file. Strings are copied from the file only when they are saved.
+//
+// Every file has one record per line with fields separated by ';' and
+// coordinates written as x,y. Empty lines and lines starting with '#' are
+// skipped.
+//   stations:         id;name;x,y
+//   regions:          id;name;x1,y1;x2,y2;...
+//   subregions:       id;parentid
+//   station regions:  stationid;regionid
+//   departures:       stationid;trainid;time
+class DatasetLoader
+{
+public:
+    // Result of loading one file
+    struct Report {
+        bool opened = false;        // the file could be opened and mapped
+        unsigned int added = 0;     // records saved to the datastructure
+        unsigned int rejected = 0;  // malformed lines and records the datastructure refused
+    };
+
+    explicit DatasetLoader(Datastructures& ds,
+                           unsigned int threads = std::thread::hardware_concurrency());
+
+    // Estimate of performance: O(nlogn)
+    // Short rationale for estimate: saving is done on one thread while t threads parse the
+    // chunks after the one saved, each station is inserted to three maps with add_stations
+    Report load_stations(std::string const& path);
+
+    // Estimate of performance: O(nlogn + c)
+    // Short rationale for estimate: saving is done on one thread while t threads parse the
+    // chunks after the one saved, each region is saved with add_region, c = all limit coordinates
+    Report load_regions(std::string const& path);
+
+    // Estimate of performance: O(n(h + s)logn)
+    // Short rationale for estimate: saving is done on one thread while t threads parse the
+    // chunks after the one saved, each pair is saved with add_subregion_to_region
+    Report load_subregions(std::string const& path);
+
+    // Estimate of performance: O(nlogn)
+    // Short rationale for estimate: saving is done on one thread while t threads parse the
+    // chunks after the one saved, each pair is saved with add_station_to_region
+    Report load_station_regions(std::string const& path);
+
+    // Estimate of performance: O(nlogn)
+    // Short rationale for estimate: t threads parse the chunks and sort them by station, while
+    // one thread saves the chunks before with add_departures: each station is searched once
+    // per chunk and its sorted new departures are merged with the old ones
+    Report load_departures(std::string const& path);
+
+private:
+    // The datastructure the records are saved to
+    Datastructures& datastructures;
+
+    // Number of threads parsing a file while it is saved
+    unsigned int thread_count;
+};
+
+#endif // INGEST_HH
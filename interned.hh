@@ -0,0 +1,76 @@
+// Interned.hh
+//
+// Student name:
+// Student email:
+// Student number:
+
+#ifndef INTERNED_HH
+#define INTERNED_HH
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Immutable value shared by all the containers and records that refer to it.
+// Copying an interned value copies only a pointer, so a string indexed by
+// several containers is stored once. Numbers are cheaper to copy than to
+// share and are stored by value.
+template <typename Value, typename = void>
+class Interned
+{
+public:
+    explicit Interned(Value value) : shared(std::make_shared<Value const>(std::move(value))) {}
+
+    Value const& operator*() const { return *shared; }
+    operator Value const&() const { return *shared; }
+
+    // Both refer to the same copy of the value
+    bool same_as(Interned const& other) const { return shared == other.shared; }
+
+    // Heap bytes of the shared copy, excluding memory owned by the value
+    static constexpr std::size_t SHARED_BYTES = sizeof(Value) + 2 * sizeof(void*);
+
+private:
+    std::shared_ptr<Value const> shared;
+};
+
+template <typename Value>
+class Interned<Value, std::enable_if_t<std::is_arithmetic_v<Value>>>
+{
+public:
+    explicit Interned(Value value) : value(value) {}
+
+    Value const& operator*() const { return value; }
+    operator Value const&() const { return value; }
+
+    bool same_as(Interned const& other) const { return value == other.value; }
+
+    static constexpr std::size_t SHARED_BYTES = 0;
+
+private:
+    Value value;
+};
+
+template <typename Value>
+inline bool operator==(Interned<Value> const& v1, Interned<Value> const& v2) { return v1.same_as(v2) || *v1 == *v2; }
+template <typename Value>
+inline bool operator!=(Interned<Value> const& v1, Interned<Value> const& v2) { return !(v1 == v2); }
+template <typename Value>
+inline bool operator<(Interned<Value> const& v1, Interned<Value> const& v2) { return *v1 < *v2; }
+
+// Orders interned values by their values. Containers keyed by interned
+// values can be searched with plain values or anything comparable to them,
+// e.g. std::string_view for strings, without interning them first.
+struct InternedLess
+{
+    using is_transparent = void;
+
+    template <typename Value>
+    bool operator()(Interned<Value> const& v1, Interned<Value> const& v2) const { return *v1 < *v2; }
+    template <typename Probe, typename Value>
+    bool operator()(Probe const& v1, Interned<Value> const& v2) const { return v1 < *v2; }
+    template <typename Value, typename Probe>
+    bool operator()(Interned<Value> const& v1, Probe const& v2) const { return *v1 < v2; }
+};
+
+#endif // INTERNED_HH
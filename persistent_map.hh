@@ -0,0 +1,307 @@
+// Persistent_map.hh
+//
+// Student name:
+// Student email:
+// Student number:
+
+#ifndef PERSISTENT_MAP_HH
+#define PERSISTENT_MAP_HH
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Ordered map whose copies share their structure. The map is a treap of
+// reference counted nodes: copying a map only copies the pointer to its root,
+// and modifying a map copies the nodes on the path from the root to the
+// modified entry that are shared with other copies (path copying). Each edit
+// therefore allocates O(logn) nodes in a copy, and nodes owned by one map
+// only are modified in place.
+//
+// Reading a map from several threads is safe as long as no thread modifies it.
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class PersistentMap
+{
+public:
+    using value_type = std::pair<Key const, Value>;
+
+private:
+    struct Node {
+        value_type entry;
+        std::uint64_t priority = 0;
+        std::shared_ptr<Node> left = nullptr;
+        std::shared_ptr<Node> right = nullptr;
+    };
+    using NodePtr = std::shared_ptr<Node>;
+
+public:
+    // Iterates the entries in key order
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = PersistentMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = value_type const*;
+        using reference = value_type const&;
+
+        const_iterator() = default;
+        explicit const_iterator(Node const* root) { push_left(root); }
+
+        reference operator*() const { return path.back()->entry; }
+        pointer operator->() const { return &path.back()->entry; }
+
+        const_iterator& operator++()
+        {
+            Node const* node = path.back();
+            path.pop_back();
+            push_left(node->right.get());
+            return *this;
+        }
+
+        bool operator==(const_iterator const& other) const
+        {
+            return path.empty() ? other.path.empty()
+                                : !other.path.empty() && path.back() == other.path.back();
+        }
+        bool operator!=(const_iterator const& other) const { return !(*this == other); }
+
+    private:
+        void push_left(Node const* node)
+        {
+            for (; node != nullptr; node = node->left.get())
+            {
+                path.push_back(node);
+            }
+        }
+
+        // Nodes whose entry and right subtree are still to be visited
+        std::vector<Node const*> path = {};
+    };
+
+    // Bytes allocated for each entry, excluding memory owned by the key and value
+    // (the node and the reference counts of its make_shared allocation)
+    static constexpr std::size_t NODE_BYTES = sizeof(Node) + 2 * sizeof(void*);
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const_iterator begin() const { return const_iterator(root.get()); }
+    const_iterator end() const { return const_iterator(); }
+
+    // Maps share all of their entries, e.g. one is an unmodified copy of the other
+    bool same_as(PersistentMap const& other) const { return root == other.root; }
+
+    // Returns the entry of key, nullptr if the key is not in the map. Keys of
+    // other types than Key can be searched if Compare can compare them with Key.
+    template <typename Probe = Key>
+    value_type const* find_entry(Probe const& key) const
+    {
+        Node const* node = root.get();
+        while (node != nullptr)
+        {
+            if (compare(key, node->entry.first)) { node = node->left.get(); }
+            else if (compare(node->entry.first, key)) { node = node->right.get(); }
+            else { return &node->entry; }
+        }
+        return nullptr;
+    }
+
+    // Returns the value of key, nullptr if the key is not in the map
+    template <typename Probe = Key>
+    Value const* find(Probe const& key) const
+    {
+        value_type const* entry = find_entry(key);
+        return entry == nullptr ? nullptr : &entry->second;
+    }
+
+    // Returns the value of key that can be modified without affecting copies
+    // of the map, nullptr if the key is not in the map
+    template <typename Probe = Key>
+    Value* find_writable(Probe const& key)
+    {
+        if (find_entry(key) == nullptr)
+        {
+            return nullptr;
+        }
+        NodePtr* link = &root;
+        while (true)
+        {
+            Node* node = writable(*link);
+            if (compare(key, node->entry.first)) { link = &node->left; }
+            else if (compare(node->entry.first, key)) { link = &node->right; }
+            else { return &node->entry.second; }
+        }
+    }
+
+    // Calls function(key, value) for the entries not shared with copies of the
+    // map, in no particular order. The values may be modified in place.
+    template <typename Function>
+    void for_each_unshared(Function function)
+    {
+        std::vector<Node*> unvisited;
+        if (root.use_count() == 1)
+        {
+            unvisited.push_back(root.get());
+        }
+        while (!unvisited.empty())
+        {
+            Node* node = unvisited.back();
+            unvisited.pop_back();
+            function(node->entry.first, node->entry.second);
+            for (NodePtr const* child : {&node->left, &node->right})
+            {
+                if (*child != nullptr && child->use_count() == 1)
+                {
+                    unvisited.push_back(child->get());
+                }
+            }
+        }
+    }
+
+    // Adds an entry, false if the key is already in the map
+    bool insert(Key key, Value value)
+    {
+        if (find_entry(key) != nullptr)
+        {
+            return false;
+        }
+        auto node = std::make_shared<Node>(Node{{std::move(key), std::move(value)}, next_priority()});
+        root = insert_node(std::move(root), std::move(node));
+        ++count;
+        return true;
+    }
+
+    // Removes an entry, false if the key is not in the map
+    template <typename Probe = Key>
+    bool erase(Probe const& key)
+    {
+        if (find_entry(key) == nullptr)
+        {
+            return false;
+        }
+        root = erase_node(std::move(root), key);
+        --count;
+        return true;
+    }
+
+private:
+    template <typename Key1, typename Key2>
+    static bool compare(Key1 const& k1, Key2 const& k2) { return Compare()(k1, k2); }
+
+    // Copies a node shared with other maps so that it can be modified
+    static Node* writable(NodePtr& node)
+    {
+        if (node.use_count() > 1)
+        {
+            node = std::make_shared<Node>(*node);
+        }
+        return node.get();
+    }
+
+    // Random heap priorities keep the treap balanced in expectation
+    static std::uint64_t next_priority()
+    {
+        static std::atomic<std::uint64_t> counter{0};
+        std::uint64_t z = (counter += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    static NodePtr rotate_right(NodePtr node)
+    {
+        NodePtr left = std::move(node->left);
+        node->left = std::move(left->right);
+        left->right = std::move(node);
+        return left;
+    }
+
+    static NodePtr rotate_left(NodePtr node)
+    {
+        NodePtr right = std::move(node->right);
+        node->right = std::move(right->left);
+        right->left = std::move(node);
+        return right;
+    }
+
+    static NodePtr insert_node(NodePtr node, NodePtr new_node)
+    {
+        if (node == nullptr)
+        {
+            return new_node;
+        }
+        Node* parent = writable(node);
+        if (compare(new_node->entry.first, parent->entry.first))
+        {
+            parent->left = insert_node(std::move(parent->left), std::move(new_node));
+            if (parent->left->priority > parent->priority)
+            {
+                return rotate_right(std::move(node));
+            }
+        }
+        else
+        {
+            parent->right = insert_node(std::move(parent->right), std::move(new_node));
+            if (parent->right->priority > parent->priority)
+            {
+                return rotate_left(std::move(node));
+            }
+        }
+        return node;
+    }
+
+    template <typename Probe>
+    static NodePtr erase_node(NodePtr node, Probe const& key)
+    {
+        if (compare(key, node->entry.first))
+        {
+            Node* parent = writable(node);
+            parent->left = erase_node(std::move(parent->left), key);
+            return node;
+        }
+        if (compare(node->entry.first, key))
+        {
+            Node* parent = writable(node);
+            parent->right = erase_node(std::move(parent->right), key);
+            return node;
+        }
+        // Subtrees of a node still used by other maps are shared, not moved
+        if (node.use_count() > 1)
+        {
+            return merge(node->left, node->right);
+        }
+        return merge(std::move(node->left), std::move(node->right));
+    }
+
+    // Joins two treaps whose keys are all smaller in the first one
+    static NodePtr merge(NodePtr first, NodePtr second)
+    {
+        if (first == nullptr)
+        {
+            return second;
+        }
+        if (second == nullptr)
+        {
+            return first;
+        }
+        if (first->priority > second->priority)
+        {
+            Node* top = writable(first);
+            top->right = merge(std::move(top->right), std::move(second));
+            return first;
+        }
+        Node* top = writable(second);
+        top->left = merge(std::move(first), std::move(top->left));
+        return second;
+    }
+
+    NodePtr root = nullptr;
+    std::size_t count = 0;
+};
+
+#endif // PERSISTENT_MAP_HH
@@ -0,0 +1,492 @@
+// Workload.cc
+//
+// Student name:
+// Student email:
+// Student number:
+
+#include "workload.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+
+using Operation = WorkloadRunner::Operation;
+
+// Trace names of the operations
+std::vector<std::pair<std::string, Operation>> const OPERATION_NAMES = {
+    {"add_station", Operation::add_station},
+    {"remove_station", Operation::remove_station},
+    {"change_station_coord", Operation::change_station_coord},
+    {"add_departure", Operation::add_departure},
+    {"remove_departure", Operation::remove_departure},
+    {"add_region", Operation::add_region},
+    {"add_subregion_to_region", Operation::add_subregion_to_region},
+    {"add_station_to_region", Operation::add_station_to_region},
+    {"get_station_name", Operation::get_station_name},
+    {"station_departures_after", Operation::station_departures_after},
+    {"stations_closest_to", Operation::stations_closest_to},
+    {"station_in_regions", Operation::station_in_regions},
+    {"common_parent_of_regions", Operation::common_parent_of_regions},
+};
+
+/**
+ * @brief percentile picks a percentile from sorted latencies
+ * @param sorted latencies in ascending order
+ * @param fraction the percentile as a fraction, e.g. 0.99
+ * @return the latency below which the given fraction of latencies fall
+ */
+double percentile(std::vector<double> const& sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    auto index = static_cast<std::size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::min(std::max<std::size_t>(index, 1), sorted.size()) - 1];
+}
+
+}
+
+/**
+ * @brief WorkloadRunner::WorkloadRunner constructor of the class
+ * @param ds the datastructure the workload is run against
+ */
+WorkloadRunner::WorkloadRunner(Datastructures& ds) : datastructures(ds) {}
+
+/**
+ * @brief WorkloadRunner::load_trace reads operations from a trace
+ * @param trace stream with one operation per line
+ * @return the number of malformed lines that were skipped
+ */
+unsigned int WorkloadRunner::load_trace(std::istream& trace)
+{
+    unsigned int rejected = 0;
+    std::string line;
+    while (std::getline(trace, line))
+    {
+        std::istringstream fields(line);
+        std::string name;
+        if (!(fields >> name) || name.front() == '#')
+        {
+            continue;
+        }
+        auto operation = std::find_if(OPERATION_NAMES.begin(), OPERATION_NAMES.end(),
+                                      [&name](auto& op_name){ return op_name.first == name; });
+        if (operation == OPERATION_NAMES.end())
+        {
+            ++rejected;
+            continue;
+        }
+        Command command;
+        command.operation = operation->second;
+        switch (command.operation)
+        {
+        case Operation::add_station:
+            fields >> command.station >> command.name >> command.xy.x >> command.xy.y;
+            break;
+        case Operation::change_station_coord:
+            fields >> command.station >> command.xy.x >> command.xy.y;
+            break;
+        case Operation::add_departure:
+        case Operation::remove_departure:
+            fields >> command.station >> command.train >> command.time;
+            break;
+        case Operation::add_region:
+            if (fields >> command.region1 >> command.name)
+            {
+                // Coordinates are read in pairs until the end of the line, the
+                // stream is left failed by anything else
+                bool pairs_complete = true;
+                for (Coord xy; fields >> xy.x;)
+                {
+                    if (!(fields >> xy.y))
+                    {
+                        pairs_complete = false;
+                        break;
+                    }
+                    command.coords.push_back(xy);
+                }
+                if (pairs_complete && fields.eof())
+                {
+                    fields.clear();
+                }
+            }
+            break;
+        case Operation::add_subregion_to_region:
+        case Operation::common_parent_of_regions:
+            fields >> command.region1 >> command.region2;
+            break;
+        case Operation::add_station_to_region:
+            fields >> command.station >> command.region1;
+            break;
+        case Operation::station_departures_after:
+            fields >> command.station >> command.time;
+            break;
+        case Operation::stations_closest_to:
+            fields >> command.xy.x >> command.xy.y;
+            break;
+        case Operation::remove_station:
+        case Operation::get_station_name:
+        case Operation::station_in_regions:
+            fields >> command.station;
+            break;
+        }
+        // Missing arguments and anything after the arguments are errors
+        if (fields.fail() || !(fields >> std::ws).eof())
+        {
+            ++rejected;
+            continue;
+        }
+        workload.push_back(std::move(command));
+    }
+    return rejected;
+}
+
+/**
+ * @brief WorkloadRunner::synthesize generates a mix of reads and timetable edits for the current dataset
+ * @param count the number of operations generated
+ * @param write_ratio the fraction of operations that edit the timetable, e.g. 0.05
+ */
+void WorkloadRunner::synthesize(unsigned int count, double write_ratio)
+{
+    std::vector<StationID> stations = datastructures.all_stations();
+    std::vector<RegionID> regions = datastructures.all_regions();
+    if (stations.empty())
+    {
+        return;
+    }
+    auto random_station = [&stations]()
+    {
+        return stations[random_in_range<std::size_t>(0, stations.size() - 1)];
+    };
+
+    // Departures added by the workload are removed later on, so that the
+    // size of the timetable stays about the same
+    std::vector<Command> added_departures;
+    unsigned int const write_limit = write_ratio * 1000;
+    unsigned int train_number = 0;
+
+    workload.reserve(workload.size() + count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        Command command;
+        if (random_in_range(0u, 999u) < write_limit)
+        {
+            unsigned int edit = random_in_range(0, 2);
+            if (edit == 0 || (edit == 1 && added_departures.empty()))
+            {
+                command.operation = Operation::add_departure;
+                command.station = random_station();
+                command.train = "W" + std::to_string(train_number++);
+                command.time = random_in_range<Time>(0, 2359);
+                added_departures.push_back(command);
+            }
+            else if (edit == 1)
+            {
+                auto index = random_in_range<std::size_t>(0, added_departures.size() - 1);
+                std::swap(added_departures[index], added_departures.back());
+                command = added_departures.back();
+                command.operation = Operation::remove_departure;
+                added_departures.pop_back();
+            }
+            else
+            {
+                command.operation = Operation::change_station_coord;
+                command.station = random_station();
+                Coord xy = datastructures.get_station_coordinates(command.station);
+                command.xy = {xy.x + random_in_range(-10, 10), xy.y + random_in_range(-10, 10)};
+            }
+        }
+        else
+        {
+            unsigned int read = random_in_range(0, regions.empty() ? 2 : 4);
+            if (read == 0)
+            {
+                command.operation = Operation::station_departures_after;
+                command.station = random_station();
+                command.time = random_in_range<Time>(0, 2359);
+            }
+            else if (read == 1)
+            {
+                command.operation = Operation::stations_closest_to;
+                Coord xy = datastructures.get_station_coordinates(random_station());
+                command.xy = {xy.x + random_in_range(-100, 100), xy.y + random_in_range(-100, 100)};
+            }
+            else if (read == 2)
+            {
+                command.operation = Operation::get_station_name;
+                command.station = random_station();
+            }
+            else if (read == 3)
+            {
+                command.operation = Operation::station_in_regions;
+                command.station = random_station();
+            }
+            else
+            {
+                command.operation = Operation::common_parent_of_regions;
+                command.region1 = regions[random_in_range<std::size_t>(0, regions.size() - 1)];
+                command.region2 = regions[random_in_range<std::size_t>(0, regions.size() - 1)];
+            }
+        }
+        workload.push_back(std::move(command));
+    }
+}
+
+/**
+ * @brief WorkloadRunner::run runs the workload with several client threads
+ * @param threads the number of client threads
+ * @return throughput and latency percentiles of the run
+ */
+WorkloadRunner::Report WorkloadRunner::run(unsigned int threads)
+{
+    threads = std::max(threads, 1u);
+    std::shared_mutex datastructures_mutex;
+    std::atomic<std::size_t> next_command{0};
+
+    // Each client keeps its own latencies for each operation
+    std::vector<std::vector<std::vector<double>>> latencies(
+                threads, std::vector<std::vector<double>>(OPERATION_NAMES.size()));
+
+    auto client = [this, &datastructures_mutex, &next_command](std::vector<std::vector<double>>& client_latencies)
+    {
+        for (std::size_t i = next_command++; i < workload.size(); i = next_command++)
+        {
+            const Command& command = workload[i];
+            auto start = std::chrono::steady_clock::now();
+            if (is_read(command.operation))
+            {
+                std::shared_lock<std::shared_mutex> lock(datastructures_mutex);
+                execute(command);
+            }
+            else
+            {
+                std::unique_lock<std::shared_mutex> lock(datastructures_mutex);
+                execute(command);
+            }
+            auto end = std::chrono::steady_clock::now();
+            client_latencies[static_cast<std::size_t>(command.operation)].push_back(
+                        std::chrono::duration<double, std::nano>(end - start).count());
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (unsigned int i = 1; i < threads; ++i)
+    {
+        clients.emplace_back(client, std::ref(latencies[i]));
+    }
+    client(latencies[0]);
+    for (auto& thread : clients)
+    {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    Report report;
+    report.operations = workload.size();
+    report.seconds = std::chrono::duration<double>(end - start).count();
+    report.throughput = report.seconds > 0 ? report.operations / report.seconds : 0;
+    for (std::size_t op = 0; op < OPERATION_NAMES.size(); ++op)
+    {
+        std::vector<double> all_latencies;
+        for (const auto& client_latencies : latencies)
+        {
+            all_latencies.insert(all_latencies.end(), client_latencies[op].begin(), client_latencies[op].end());
+        }
+        if (all_latencies.empty())
+        {
+            continue;
+        }
+        std::sort(all_latencies.begin(), all_latencies.end()); // O(nlogn)
+        report.latencies[OPERATION_NAMES[op].first] = {all_latencies.size(),
+                                                       percentile(all_latencies, 0.5),
+                                                       percentile(all_latencies, 0.99),
+                                                       percentile(all_latencies, 0.999)};
+    }
+    return report;
+}
+
+/**
+ * @brief WorkloadRunner::clear_workload removes all loaded and synthesized operations
+ */
+void WorkloadRunner::clear_workload()
+{
+    workload.clear();
+}
+
+/**
+ * @brief WorkloadRunner::print_report writes a report, one operation per line
+ * @param report the report written
+ * @param output the stream written to
+ */
+void WorkloadRunner::print_report(const Report& report, std::ostream& output)
+{
+    output << std::fixed << std::setprecision(1);
+    output << "operations " << report.operations << " seconds " << report.seconds
+           << " throughput " << report.throughput << "\n";
+    output << "# operation count p50_ns p99_ns p999_ns\n";
+    for (const auto& [name, stats] : report.latencies)
+    {
+        output << name << " " << stats.count << " " << stats.p50 << " "
+               << stats.p99 << " " << stats.p999 << "\n";
+    }
+}
+
+/**
+ * @brief WorkloadRunner::compare_reports checks a candidate build's report against a baseline report
+ * @param baseline report of the baseline build
+ * @param candidate report of the candidate build
+ * @param tolerance allowed relative increase of tail latencies and decrease of throughput
+ * @param output stream where the comparison is written
+ * @return bool value indicating if the candidate is within tolerance
+ */
+bool WorkloadRunner::compare_reports(std::istream& baseline, std::istream& candidate,
+                                     double tolerance, std::ostream& output)
+{
+    Report base = read_report(baseline);
+    Report cand = read_report(candidate);
+    bool within_tolerance = true;
+
+    output << std::fixed << std::setprecision(3);
+    output << "throughput " << cand.throughput / std::max(base.throughput, 1.0) << "x";
+    if (cand.throughput < base.throughput * (1 - tolerance))
+    {
+        output << " REGRESSION";
+        within_tolerance = false;
+    }
+    output << "\n";
+
+    for (const auto& [name, base_stats] : base.latencies)
+    {
+        auto cand_stats = cand.latencies.find(name);
+        // An operation the candidate did not run can not be compared, so it
+        // is not let through silently
+        if (cand_stats == cand.latencies.end())
+        {
+            output << name << " missing REGRESSION\n";
+            within_tolerance = false;
+            continue;
+        }
+        double p99_ratio = cand_stats->second.p99 / std::max(base_stats.p99, 1.0);
+        double p999_ratio = cand_stats->second.p999 / std::max(base_stats.p999, 1.0);
+        output << name << " p99 " << p99_ratio << "x p999 " << p999_ratio << "x";
+        if (p99_ratio > 1 + tolerance || p999_ratio > 1 + tolerance)
+        {
+            output << " REGRESSION";
+            within_tolerance = false;
+        }
+        output << "\n";
+    }
+    return within_tolerance;
+}
+
+/**
+ * @brief WorkloadRunner::execute runs one command against the datastructure
+ * @param command the command
+ */
+void WorkloadRunner::execute(const Command& command)
+{
+    switch (command.operation)
+    {
+    case Operation::add_station:
+        datastructures.add_station(command.station, command.name, command.xy);
+        break;
+    case Operation::remove_station:
+        datastructures.remove_station(command.station);
+        break;
+    case Operation::change_station_coord:
+        datastructures.change_station_coord(command.station, command.xy);
+        break;
+    case Operation::add_departure:
+        datastructures.add_departure(command.station, command.train, command.time);
+        break;
+    case Operation::remove_departure:
+        datastructures.remove_departure(command.station, command.train, command.time);
+        break;
+    case Operation::add_region:
+        datastructures.add_region(command.region1, command.name, command.coords);
+        break;
+    case Operation::add_subregion_to_region:
+        datastructures.add_subregion_to_region(command.region1, command.region2);
+        break;
+    case Operation::add_station_to_region:
+        datastructures.add_station_to_region(command.station, command.region1);
+        break;
+    case Operation::get_station_name:
+        datastructures.get_station_name(command.station);
+        break;
+    case Operation::station_departures_after:
+        datastructures.station_departures_after(command.station, command.time);
+        break;
+    case Operation::stations_closest_to:
+        datastructures.stations_closest_to(command.xy);
+        break;
+    case Operation::station_in_regions:
+        datastructures.station_in_regions(command.station);
+        break;
+    case Operation::common_parent_of_regions:
+        datastructures.common_parent_of_regions(command.region1, command.region2);
+        break;
+    }
+}
+
+/**
+ * @brief WorkloadRunner::is_read tells if an operation only reads the datastructure
+ * @param operation the operation
+ * @return bool value indicating if the operation can run in parallel with other reads
+ */
+bool WorkloadRunner::is_read(Operation operation)
+{
+    switch (operation)
+    {
+    case Operation::get_station_name:
+    case Operation::station_departures_after:
+    case Operation::stations_closest_to:
+    case Operation::station_in_regions:
+    case Operation::common_parent_of_regions:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief WorkloadRunner::read_report reads a report written by print_report
+ * @param input the stream read from
+ * @return the report
+ */
+WorkloadRunner::Report WorkloadRunner::read_report(std::istream& input)
+{
+    Report report;
+    std::string line;
+    while (std::getline(input, line))
+    {
+        std::istringstream fields(line);
+        std::string name;
+        if (!(fields >> name) || name.front() == '#')
+        {
+            continue;
+        }
+        if (name == "operations")
+        {
+            std::string label;
+            fields >> report.operations >> label >> report.seconds >> label >> report.throughput;
+            continue;
+        }
+        OperationStats stats;
+        if (fields >> stats.count >> stats.p50 >> stats.p99 >> stats.p999)
+        {
+            report.latencies[name] = stats;
+        }
+    }
+    return report;
+}
@@ -0,0 +1,127 @@
+// Workload.hh
+//
+// Student name:
+// Student email:
+// Student number:
+
+#ifndef WORKLOAD_HH
+#define WORKLOAD_HH
+
+#include "datastructures.hh"
+
+#include <istream>
+#include <map>
+#include <ostream>
+
+// Replays operation traces against a Datastructures and reports throughput
+// and latency percentiles for each operation.
+//
+// A trace has one operation per line with whitespace separated arguments,
+// coordinates are written as two integers. Empty lines and lines starting
+// with '#' are skipped, lines with missing or extra arguments are rejected.
+//   add_station id name x y
+//   remove_station id
+//   change_station_coord id x y
+//   add_departure stationid trainid time
+//   remove_departure stationid trainid time
+//   add_region id name x1 y1 x2 y2 ...
+//   add_subregion_to_region id parentid
+//   add_station_to_region id regionid
+//   get_station_name id
+//   station_departures_after stationid time
+//   stations_closest_to x y
+//   station_in_regions id
+//   common_parent_of_regions id1 id2
+//
+// Operations are run by several client threads. Reads share the
+// datastructure, edits have it exclusively.
+class WorkloadRunner
+{
+public:
+    enum class Operation {
+        add_station, remove_station, change_station_coord,
+        add_departure, remove_departure,
+        add_region, add_subregion_to_region, add_station_to_region,
+        get_station_name, station_departures_after, stations_closest_to,
+        station_in_regions, common_parent_of_regions
+    };
+
+    // One operation of a trace with its arguments
+    struct Command {
+        Operation operation = Operation::get_station_name;
+        StationID station = NO_STATION;
+        TrainID train = NO_TRAIN;
+        Name name = NO_NAME;
+        RegionID region1 = NO_REGION;
+        RegionID region2 = NO_REGION;
+        Coord xy = NO_COORD;
+        Time time = NO_TIME;
+        std::vector<Coord> coords = {};
+    };
+
+    // Latencies of one operation in nanoseconds
+    struct OperationStats {
+        unsigned long count = 0;
+        double p50 = 0;
+        double p99 = 0;
+        double p999 = 0;
+    };
+
+    // Results of a run, operations are listed by their trace names
+    struct Report {
+        unsigned long operations = 0;
+        double seconds = 0;
+        double throughput = 0;  // operations per second
+        std::map<std::string, OperationStats> latencies = {};
+    };
+
+    explicit WorkloadRunner(Datastructures& ds);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: each line of the trace is parsed once
+    // Returns the number of malformed lines, valid lines are appended to the workload
+    unsigned int load_trace(std::istream& trace);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: each operation picks its arguments from the existing
+    // stations and regions with random_in_range
+    // Appends count operations of which write_ratio are timetable edits
+    void synthesize(unsigned int count, double write_ratio);
+
+    // Estimate of performance: O(nlogn)
+    // Short rationale for estimate: each operation is run once, latencies are sorted
+    Report run(unsigned int threads);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: clearing the workload vector
+    void clear_workload();
+
+    // Writes a report in the format read by compare_reports
+    static void print_report(Report const& report, std::ostream& output);
+
+    // Estimate of performance: O(n)
+    // Short rationale for estimate: each operation of the two reports is compared once
+    // Returns false and lists the regressions if a p99 or p999 latency of the candidate is
+    // more than tolerance (e.g. 0.1 = 10%) above the baseline, or if the candidate is
+    // missing an operation of the baseline
+    static bool compare_reports(std::istream& baseline, std::istream& candidate,
+                                double tolerance, std::ostream& output);
+
+private:
+    // Runs one command against the datastructure
+    void execute(Command const& command);
+
+    // Read operations can be run in parallel
+    static bool is_read(Operation operation);
+
+    // Reads a report written by print_report
+    static Report read_report(std::istream& input);
+
+    // The datastructure the workload is run against
+    Datastructures& datastructures;
+
+    // Commands in the order they were loaded or synthesized
+    std::vector<Command> workload;
+};
+
+#endif // WORKLOAD_HH